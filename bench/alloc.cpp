@@ -0,0 +1,360 @@
+#include "ctl/allocator.hpp"
+#include "ctl/pool.hpp"
+#include "ctl/slab.hpp"
+#include "ctl/tracking.hpp"
+
+#include "bench.hpp"
+
+namespace ctl::bench {
+
+    // Reproducible workloads over every allocator. Sizes and free orders come
+    // from a fixed seed so two builds run exactly the same operations.
+    static inline constexpr const Ulen BLOCKS = 4096; // Live blocks per round
+    static inline constexpr const Ulen ROUNDS = 64;
+    static inline constexpr const Ulen BUFFERS = 64; // Interleaved buffers in grow
+    static inline constexpr const Ulen GROW_MAX = 64 << 10;
+    static inline constexpr const Ulen OBJECT_SIZE = 64; // Pool and Slab
+    static inline constexpr const Ulen THREADS[] = { 2, 4, 8 };
+    static inline constexpr const Ulen TRACKED_THREADS[] = { 1, 4, 8 };
+
+    struct Random {
+	Uint64 next() {
+            state_ = state_ * 6364136223846793005_u64 + 1442695040888963407_u64;
+            return state_ >> 33;
+	}
+	Uint64 state_ = 0x853c49e6748fea9b_u64;
+    };
+
+    // The operations of one round, shared by every subject.
+    struct Plan {
+	Plan(Allocator& allocator)
+            : allocator_{allocator}
+            , sizes{allocator.allocate<Ulen>(BLOCKS, false)}
+            , order{allocator.allocate<Ulen>(BLOCKS, false)}
+	{
+            if (!sizes || !order) {
+                return;
+            }
+            Random random;
+            for (Ulen i = 0; i < BLOCKS; i++) {
+                // Mostly small blocks with a tail up to 4 KiB.
+                const auto r = random.next();
+                sizes[i] = (r & 7) == 0 ? 1024 + (r >> 3) % 3072 : 16 + (r >> 3) % 496;
+                order[i] = i;
+            }
+            for (Ulen i = BLOCKS - 1; i > 0; i--) {
+                const auto j = Ulen(random.next() % (i + 1));
+                const auto tmp = order[i];
+                order[i] = order[j];
+                order[j] = tmp;
+            }
+	}
+	~Plan() {
+            allocator_.deallocate(sizes, BLOCKS);
+            allocator_.deallocate(order, BLOCKS);
+	}
+	Allocator& allocator_;
+	Ulen*      sizes;
+	Ulen*      order;
+    };
+
+    // Subjects give every allocator the same shape. Handles are addresses for
+    // the Allocator based ones and index + 1 for Pool and Slab, 0 is failure.
+    // reset() runs between rounds, outside of the timed region.
+
+    struct SystemSubject {
+	static constexpr const Bool FIXED = false;
+	SystemSubject(Allocator&) {}
+	Allocator& allocator() { return system_; }
+	void reset() {}
+	SystemAllocator system_;
+    };
+
+    // Allocates straight from the allocator it is given, so threads can share
+    // one TrackingAllocator.
+    struct SharedSubject {
+	static constexpr const Bool FIXED = false;
+	SharedSubject(Allocator& parent) : parent_{parent} {}
+	Allocator& allocator() { return parent_; }
+	void reset() {}
+	Allocator& parent_;
+    };
+
+    struct ArenaSubject {
+	static constexpr const Bool FIXED = false;
+	static constexpr const Ulen CAPACITY = 32 << 20;
+	ArenaSubject(Allocator& parent)
+            : parent_{parent}
+            , data_{parent.alloc(CAPACITY, false)}
+            , arena_{data_, data_ ? CAPACITY : 0}
+	{}
+	~ArenaSubject() { parent_.free(data_, CAPACITY); }
+	Allocator& allocator() { return arena_; }
+	void reset() { arena_.reset(); }
+	Allocator&     parent_;
+	Address        data_;
+	ArenaAllocator arena_;
+    };
+
+    struct TemporarySubject {
+	static constexpr const Bool FIXED = false;
+	TemporarySubject(Allocator& parent) : temporary_{parent} {}
+	Allocator& allocator() { return temporary_; }
+	void reset() { temporary_.reset(); }
+	TemporaryAllocator temporary_;
+    };
+
+    struct ScratchSubject {
+	static constexpr const Bool FIXED = false;
+	using Scratch = ScratchAllocator<4096>;
+	ScratchSubject(Allocator& parent) : parent_{parent} { new (storage_, Nat{}) Scratch{parent}; }
+	~ScratchSubject() { scratch().~Scratch(); }
+	Allocator& allocator() { return scratch(); }
+	void reset() {
+            // No reset() on ScratchAllocator, start over with a fresh one.
+            scratch().~Scratch();
+            new (storage_, Nat{}) Scratch{parent_};
+	}
+	Scratch& scratch() { return *reinterpret_cast<Scratch*>(storage_); }
+	Allocator& parent_;
+	alignas(Scratch) Uint8 storage_[sizeof(Scratch)];
+    };
+
+    struct PoolSubject {
+	static constexpr const Bool FIXED = true;
+	PoolSubject(Allocator& parent) : pool_{Pool::create(parent, OBJECT_SIZE, BLOCKS)} {}
+	Address alloc(Ulen) {
+            if (auto ref = pool_->allocate()) return Address(ref->index) + 1;
+            return 0;
+	}
+	void free(Address handle, Ulen) { pool_->deallocate(PoolRef { Uint32(handle - 1) }); }
+	void reset() {}
+	Maybe<Pool> pool_;
+    };
+
+    struct SlabSubject {
+	static constexpr const Bool FIXED = true;
+	SlabSubject(Allocator& parent) : slab_{parent, OBJECT_SIZE, 1024} {}
+	Address alloc(Ulen) {
+            if (auto ref = slab_.allocate()) return Address(ref->index) + 1;
+            return 0;
+	}
+	void free(Address handle, Ulen) { slab_.deallocate(SlabRef { Uint32(handle - 1) }); }
+	void reset() {}
+	Slab slab_;
+    };
+
+    template<typename S>
+    static CTL_FORCEINLINE Address alloc(S& subject, Ulen len) {
+	if constexpr (S::FIXED) {
+            return subject.alloc(len);
+	} else {
+            return subject.allocator().alloc(len, false);
+	}
+    }
+
+    template<typename S>
+    static CTL_FORCEINLINE void free(S& subject, Address handle, Ulen len) {
+	if constexpr (S::FIXED) {
+            subject.free(handle, len);
+	} else {
+            subject.allocator().free(handle, len);
+	}
+    }
+
+    // Allocate every block of the plan, then free them in reverse (lifo) or in
+    // shuffled order (random).
+    template<typename S>
+    static Bool alloc_free(S& subject, const Plan& plan, Address* handles, Samples& samples, Bool shuffled) {
+	for (Ulen round = 0; round < ROUNDS; round++) {
+            for (Ulen i = 0; i < BLOCKS; i += Samples::BATCH) {
+                const auto beg = now();
+                for (Ulen j = i; j < i + Samples::BATCH; j++) {
+                    handles[j] = alloc(subject, plan.sizes[j]);
+                }
+                samples.add(now() - beg, Samples::BATCH);
+            }
+            for (Ulen i = 0; i < BLOCKS; i++) {
+                if (!handles[i]) return false;
+            }
+            for (Ulen i = 0; i < BLOCKS; i += Samples::BATCH) {
+                const auto beg = now();
+                for (Ulen j = i; j < i + Samples::BATCH; j++) {
+                    const auto k = shuffled ? plan.order[j] : BLOCKS - 1 - j;
+                    free(subject, handles[k], plan.sizes[k]);
+                }
+                samples.add(now() - beg, Samples::BATCH);
+            }
+            subject.reset();
+	}
+	return true;
+    }
+
+    // Grow BUFFERS buffers round-robin by 1.5x from 16 bytes to GROW_MAX, the
+    // way an array is appended to, then free them.
+    template<typename S>
+    static Bool grow(S& subject, Address* handles, Samples& samples) {
+	auto& allocator = subject.allocator();
+	for (Ulen round = 0; round < ROUNDS / 8; round++) {
+            Ulen len = 16;
+            for (Ulen i = 0; i < BUFFERS; i++) {
+                if (!(handles[i] = allocator.alloc(len, false))) return false;
+            }
+            while (len < GROW_MAX) {
+                const auto new_len = len + len / 2;
+                const auto beg = now();
+                for (Ulen i = 0; i < BUFFERS; i++) {
+                    if (!(handles[i] = allocator.grow(handles[i], len, new_len, false))) return false;
+                }
+                samples.add(now() - beg, BUFFERS);
+                len = new_len;
+            }
+            for (Ulen i = 0; i < BUFFERS; i++) {
+                allocator.free(handles[i], len);
+            }
+            subject.reset();
+	}
+	return true;
+    }
+
+    static void label(StringView subject, StringView workload, StringBuilder& out) {
+	out.put(subject);
+	out.put('-');
+	out.put(workload);
+    }
+
+    template<typename S>
+    static void run_alloc_free(StringView name, StringView workload, const Plan& plan, Bool shuffled) {
+	SystemAllocator sys;
+	S subject{sys};
+	auto handles = sys.allocate<Address>(BLOCKS, true);
+	Samples samples{sys, 2 * BLOCKS * ROUNDS / Samples::BATCH};
+	if (!handles) {
+            return;
+	}
+	reset_peak_rss();
+	const auto beg = now();
+	const auto ok = alloc_free(subject, plan, handles, samples, shuffled);
+	const auto end = now();
+	sys.deallocate(handles, BLOCKS);
+	InlineAllocator<128> buf;
+	StringBuilder out{buf};
+	label(name, ok ? workload : StringView{"failed"}, out);
+	if (auto result = out.result()) {
+            report("alloc", *result, samples, end - beg);
+	}
+    }
+
+    template<typename S>
+    static void run_grow(StringView name) {
+	SystemAllocator sys;
+	S subject{sys};
+	Address handles[BUFFERS];
+	Samples samples{sys, 64 * ROUNDS};
+	reset_peak_rss();
+	const auto beg = now();
+	const auto ok = grow(subject, handles, samples);
+	const auto end = now();
+	InlineAllocator<128> buf;
+	StringBuilder out{buf};
+	label(name, ok ? StringView{"grow"} : StringView{"grow-failed"}, out);
+	if (auto result = out.result()) {
+            report("alloc", *result, samples, end - beg);
+	}
+    }
+
+    // Every thread runs the random workload on its own subject. The allocators
+    // are not thread safe, but SystemAllocator instances share the global heap.
+    template<typename S>
+    struct Threaded {
+	static void run(Ulen index, void* data) {
+            const auto self = static_cast<Threaded*>(data);
+            SystemAllocator sys;
+            S subject{self->parent ? *self->parent : sys};
+            auto handles = sys.allocate<Address>(BLOCKS, true);
+            if (!handles) {
+                return;
+            }
+            if (!alloc_free(subject, *self->plan, handles, *self->samples[index], true)) {
+                self->failed = true;
+            }
+            sys.deallocate(handles, BLOCKS);
+	}
+	const Plan* plan;
+	Allocator*  parent = nullptr; // Shared by every thread when set
+	Samples*    samples[MAX_THREADS];
+	Bool        failed = false;
+    };
+
+    template<typename S>
+    static void run_threads(StringView name, const Plan& plan, Ulen n_threads, Allocator* parent = nullptr) {
+	SystemAllocator sys;
+	const auto capacity = 2 * BLOCKS * ROUNDS / Samples::BATCH;
+	Threaded<S> state;
+	state.plan = &plan;
+	state.parent = parent;
+	for (Ulen i = 0; i < n_threads; i++) {
+            state.samples[i] = sys.create<Samples>(sys, capacity);
+            if (!state.samples[i]) {
+                for (Ulen j = 0; j < i; j++) {
+                    sys.destroy(state.samples[j]);
+                }
+                return;
+            }
+	}
+	reset_peak_rss();
+	const auto beg = now();
+	bench::run_threads(n_threads, Threaded<S>::run, &state);
+	const auto end = now();
+	Samples merged{sys, capacity * n_threads};
+	for (Ulen i = 0; i < n_threads; i++) {
+            merged.merge(*state.samples[i]);
+            sys.destroy(state.samples[i]);
+	}
+	InlineAllocator<128> buf;
+	StringBuilder out{buf};
+	out.put(name);
+	out.put(state.failed ? StringView{"-threads-failed-"} : StringView{"-threads-"});
+	out.put(Uint64(n_threads));
+	if (auto result = out.result()) {
+            // Wall clock over the operations of all threads: aggregate throughput.
+            report("alloc", *result, merged, end - beg);
+	}
+    }
+
+    template<typename S>
+    static void subject(StringView name, const Plan& plan) {
+	run_alloc_free<S>(name, "lifo", plan, false);
+	run_alloc_free<S>(name, "random", plan, true);
+	if constexpr (!S::FIXED) {
+            run_grow<S>(name);
+	}
+	for (const auto n_threads : THREADS) {
+            run_threads<S>(name, plan, n_threads);
+	}
+    }
+
+    void alloc() {
+	SystemAllocator sys;
+	const Plan plan{sys};
+	if (!plan.sizes || !plan.order) {
+            return;
+	}
+	subject<ArenaSubject>("arena", plan);
+	subject<TemporarySubject>("temporary", plan);
+	subject<ScratchSubject>("scratch", plan);
+	subject<SystemSubject>("system", plan);
+	subject<PoolSubject>("pool", plan);
+	subject<SlabSubject>("slab", plan);
+
+	// What tracking costs: every thread going through one TrackingAllocator
+	// against the same SystemAllocator untracked.
+	SystemAllocator untracked;
+	TrackingAllocator tracked{untracked, "bench"};
+	for (const auto n_threads : TRACKED_THREADS) {
+            run_threads<SharedSubject>("untracked", plan, n_threads, &untracked);
+            run_threads<SharedSubject>("tracked", plan, n_threads, &tracked);
+	}
+    }
+
+} // namespace ctl::bench
@@ -0,0 +1,148 @@
+#include "ctl/array.hpp"
+#include "ctl/small_array.hpp"
+
+#include "bench.hpp"
+
+namespace ctl::bench {
+
+    static volatile Uint64 g_sink;
+
+    // A Uint64 that Array grows with Allocator::grow.
+    struct Relocatable {
+	Relocatable(Uint64 value) : value{value} {}
+	Uint64 value;
+    };
+    static_assert(TriviallyRelocatable<Relocatable>);
+
+    // Same bytes as a Uint64, but the user provided move constructor keeps it
+    // off the relocation path, so Array grows it element by element.
+    struct Boxed {
+	Boxed(Uint64 value) : value{value} {}
+	Boxed(Boxed&& other) : value{other.value} {}
+	Uint64 value;
+    };
+    static_assert(!TriviallyRelocatable<Boxed>);
+
+    // Append `n` elements one at a time to an array that starts empty, so the
+    // cost of every growth is in the number.
+    template<typename T>
+    static void push_back(StringView name, Allocator& allocator, Ulen n) {
+	const auto beg = now();
+	Array<T> array{allocator};
+	for (Ulen i = 0; i < n; i++) {
+            if (!array.push_back(T{i})) {
+                return;
+            }
+	}
+	const auto end = now();
+	g_sink = array.last().value;
+	report("array", name, n, end - beg);
+    }
+
+    // Element counts for the container workloads: every container holds 4
+    // elements, or nine in ten hold 0 to 8 and the rest up to 64.
+    static Ulen next_size(Uint64& state, Bool mixed) {
+	if (!mixed) {
+            return 4;
+	}
+	state = state * 6364136223846793005_u64 + 1442695040888963407_u64;
+	const auto roll = Ulen(state >> 33);
+	return roll % 10 != 0 ? roll % 9 : 9 + roll % 56;
+    }
+
+    // Builds, sums and destroys a short lived container per iteration, like a
+    // per-entity list gathered in a system update.
+    template<typename C>
+    static void build(StringView name, Allocator& allocator, Bool mixed) {
+	static constexpr const Ulen ROUNDS = 1 << 20;
+	Uint64 state = 0x853c49e6748fea9b_u64;
+	Uint64 sum = 0;
+	Ulen ops = 0;
+	const auto beg = now();
+	for (Ulen round = 0; round < ROUNDS; round++) {
+            C container{allocator};
+            const auto n = next_size(state, mixed);
+            for (Ulen i = 0; i < n; i++) {
+                if (!container.push_back(Uint32(i))) {
+                    return;
+                }
+            }
+            for (const auto value : container) {
+                sum += value;
+            }
+            ops += n + 1;
+	}
+	const auto end = now();
+	g_sink = sum;
+	report("array", name, ops, end - beg);
+    }
+
+    // Keeps a container per entity and sums all of them, the inline elements
+    // sit next to the container while an Array's are a pointer away.
+    template<typename C>
+    static void walk(StringView name, Allocator& allocator, Bool mixed) {
+	static constexpr const Ulen ENTITIES = 64 << 10;
+	static constexpr const Ulen PASSES   = 32;
+	Array<C> entities{allocator};
+	if (!entities.reserve(ENTITIES)) {
+            return;
+	}
+	Uint64 state = 0x853c49e6748fea9b_u64;
+	Ulen n_elements = 0;
+	for (Ulen e = 0; e < ENTITIES; e++) {
+            C container{allocator};
+            const auto n = next_size(state, mixed);
+            for (Ulen i = 0; i < n; i++) {
+                if (!container.push_back(Uint32(e + i))) {
+                    return;
+                }
+            }
+            n_elements += n;
+            if (!entities.push_back(move(container))) {
+                return;
+            }
+	}
+	Uint64 sum = 0;
+	const auto beg = now();
+	for (Ulen pass = 0; pass < PASSES; pass++) {
+            for (const auto& container : entities) {
+                for (const auto value : container) {
+                    sum += value;
+                }
+            }
+	}
+	const auto end = now();
+	g_sink = sum;
+	report("array", name, n_elements * PASSES, end - beg);
+    }
+
+    void array() {
+	static constexpr const Ulen N = 4 << 20; // 32 MiB of elements
+	SystemAllocator sys;
+	if (auto arena = VirtualArena::create()) {
+            push_back<Relocatable>("push-back-virtual-arena", *arena, N);
+            arena->reset();
+            push_back<Boxed>("push-back-virtual-arena-boxed", *arena, N);
+	}
+	{
+            TemporaryAllocator temporary{sys};
+            push_back<Relocatable>("push-back-temporary", temporary, N);
+	}
+	{
+            TemporaryAllocator temporary{sys};
+            push_back<Boxed>("push-back-temporary-boxed", temporary, N);
+	}
+	push_back<Relocatable>("push-back-system", sys, N);
+	push_back<Boxed>("push-back-system-boxed", sys, N);
+	using Small = SmallArray<Uint32, 8>;
+	build<Array<Uint32>>("build-4-array", sys, false);
+	build<Small>("build-4-small-array", sys, false);
+	build<Array<Uint32>>("build-mixed-array", sys, true);
+	build<Small>("build-mixed-small-array", sys, true);
+	walk<Array<Uint32>>("walk-4-array", sys, false);
+	walk<Small>("walk-4-small-array", sys, false);
+	walk<Array<Uint32>>("walk-mixed-array", sys, true);
+	walk<Small>("walk-mixed-small-array", sys, true);
+    }
+
+} // namespace ctl::bench
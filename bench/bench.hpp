@@ -0,0 +1,73 @@
+#ifndef CTL_BENCH_HPP
+#define CTL_BENCH_HPP
+#include "ctl/string.hpp"
+
+namespace ctl::bench {
+
+    /// @brief Monotonic clock in nanoseconds.
+    Uint64 now();
+
+    /// @brief Peak resident set size of the process in KiB.
+    ///
+    /// On Linux the peak is restarted by `reset_peak_rss`, elsewhere it is the
+    /// peak over the whole process lifetime.
+    Uint64 peak_rss();
+
+    /// @brief Restarts peak RSS tracking where the platform allows it.
+    void reset_peak_rss();
+
+    /// @brief Runs `fn(index, data)` on `n` threads (at most MAX_THREADS) and waits for them.
+    static inline constexpr const Ulen MAX_THREADS = 64;
+    void run_threads(Ulen n, void (*fn)(Ulen index, void* data), void* data);
+
+    /// @brief Batched timings of one workload.
+    ///
+    /// Timing single operations would mostly measure the clock, so workloads time
+    /// batches of about BATCH operations and the percentiles are over the ns/op
+    /// of each batch. Storage is reserved up front so recording never allocates.
+    struct Samples {
+	static inline constexpr const Ulen BATCH = 64;
+
+	Samples(Allocator& allocator, Ulen capacity);
+	Samples(const Samples&) = delete;
+	~Samples();
+
+        /// @brief Records a batch of `ops` operations that took `elapsed_ns`.
+	void add(Uint64 elapsed_ns, Ulen ops);
+
+        /// @brief Appends the batches recorded by `other`.
+	void merge(const Samples& other);
+
+        /// @brief Returns the `p`-th percentile (0 to 100) of the per-batch ns/op.
+	Float64 percentile(Float64 p);
+
+	[[nodiscard]] CTL_FORCEINLINE constexpr Ulen ops() const { return ops_; }
+    private:
+	Allocator& allocator_;
+	Float64*   data_;
+	Ulen       length_   = 0;
+	Ulen       capacity_ = 0;
+	Ulen       ops_      = 0;
+	Bool       sorted_   = false;
+    };
+
+    /// @brief Prints one result line: `suite/name  ops  ns/op`.
+    void report(StringView suite, StringView name, Ulen ops, Uint64 elapsed_ns);
+
+    /// @brief Prints one result line with the percentiles of `samples`. The
+    /// ns/op is `elapsed_ns` (wall clock) over the operations in `samples`.
+    void report(StringView suite, StringView name, Samples& samples, Uint64 elapsed_ns);
+
+    // Benchmark suites, one per translation unit.
+    void alloc();
+    void array();
+    void hash_map();
+    void heap();
+    void memory();
+    void pool();
+    void slab();
+    void temporary();
+
+} // namespace ctl::bench
+
+#endif // CTL_BENCH_HPP
@@ -0,0 +1,178 @@
+#include "ctl/hash_map.hpp"
+
+#include "bench.hpp"
+
+namespace ctl::bench {
+
+    static volatile Uint64 g_sink;
+
+    static Uint64 next_random(Uint64& state) {
+	state = state * 6364136223846793005_u64 + 1442695040888963407_u64;
+	return state >> 17;
+    }
+
+    struct Pair {
+	Uint64 key;
+	Uint64 value;
+    };
+
+    // What the map replaces: a linear search over an Array of key value pairs.
+    static void find_linear(StringView name, Allocator& allocator, Ulen n, Ulen n_finds) {
+	Array<Pair> pairs{allocator};
+	for (Ulen i = 0; i < n; i++) {
+            if (!pairs.push_back(Pair{i * 7919, i})) {
+                return;
+            }
+	}
+	Uint64 state = 0x853c49e6748fea9b_u64;
+	Uint64 sum = 0;
+	const auto beg = now();
+	for (Ulen i = 0; i < n_finds; i++) {
+            // Every other key is a miss.
+            const auto key = (next_random(state) % (n * 2)) * 7919;
+            for (const auto& pair : pairs) {
+                if (pair.key == key) {
+                    sum += pair.value;
+                    break;
+                }
+            }
+	}
+	const auto end = now();
+	g_sink = sum;
+	report("hash_map", name, n_finds, end - beg);
+    }
+
+    static void find_hash_map(StringView name, Allocator& allocator, Ulen n, Ulen n_finds) {
+	HashMap<Uint64, Uint64> map{allocator};
+	for (Ulen i = 0; i < n; i++) {
+            if (!map.insert(Uint64(i * 7919), Uint64(i))) {
+                return;
+            }
+	}
+	Uint64 state = 0x853c49e6748fea9b_u64;
+	Uint64 sum = 0;
+	const auto beg = now();
+	for (Ulen i = 0; i < n_finds; i++) {
+            const auto key = (next_random(state) % (n * 2)) * 7919;
+            if (const auto value = map.find(key)) {
+                sum += *value;
+            }
+	}
+	const auto end = now();
+	g_sink = sum;
+	report("hash_map", name, n_finds, end - beg);
+    }
+
+    // Inserts into an empty map one key at a time, so the rehashes are in the
+    // number, or into one reserved up front.
+    static void insert(StringView name, Allocator& allocator, Ulen n, Bool reserve) {
+	const auto beg = now();
+	HashMap<Uint64, Uint64> map{allocator};
+	if (reserve && !map.reserve(n)) {
+            return;
+	}
+	Uint64 state = 0x853c49e6748fea9b_u64;
+	for (Ulen i = 0; i < n; i++) {
+            if (!map.insert(next_random(state), Uint64(i))) {
+                return;
+            }
+	}
+	const auto end = now();
+	g_sink = map.length();
+	report("hash_map", name, n, end - beg);
+    }
+
+    // Keeps the map at a steady size while keys come and go, which is where
+    // tombstones would pile up. Every op is one insert and one remove.
+    static void churn(StringView name, Allocator& allocator, Ulen n, Ulen n_ops) {
+	HashMap<Uint64, Uint64> map{allocator};
+	Array<Uint64> keys{allocator};
+	if (!keys.resize(n)) {
+            return;
+	}
+	Uint64 state = 0x853c49e6748fea9b_u64;
+	for (Ulen i = 0; i < n; i++) {
+            keys[i] = next_random(state);
+            if (!map.insert(Uint64(keys[i]), Uint64(i))) {
+                return;
+            }
+	}
+	const auto capacity = map.capacity();
+	const auto beg = now();
+	for (Ulen i = 0; i < n_ops; i++) {
+            auto& key = keys[next_random(state) % n];
+            map.remove(key);
+            key = next_random(state);
+            if (!map.insert(Uint64(key), Uint64(i))) {
+                return;
+            }
+	}
+	const auto end = now();
+	g_sink = map.length() + (map.capacity() != capacity);
+	report("hash_map", name, n_ops, end - beg);
+    }
+
+    // Owned string keys looked up through a StringView, no key is built for
+    // the lookup.
+    static void find_string(StringView name, Allocator& allocator, Ulen n, Ulen n_finds) {
+	// Names for 2n entities, the first n go in the map.
+	StringBuilder builder{allocator};
+	Array<Ulen> offsets{allocator};
+	for (Ulen i = 0; i < n * 2; i++) {
+            builder.put("entity/");
+            builder.put(Uint64(i));
+            const auto built = builder.result();
+            if (!built || !offsets.push_back(built->length())) {
+                return;
+            }
+	}
+	const auto names = builder.result();
+	if (!names) {
+            return;
+	}
+	const auto view = [&](Ulen i) {
+            const auto beg = i ? offsets[i - 1] : 0;
+            return names->subrange(beg, offsets[i]);
+	};
+	HashMap<Array<char>, Uint64> map{allocator};
+	for (Ulen i = 0; i < n; i++) {
+            Array<char> key{allocator};
+            for (const auto ch : view(i)) {
+                if (!key.push_back(char(ch))) {
+                    return;
+                }
+            }
+            if (!map.insert(move(key), Uint64(i))) {
+                return;
+            }
+	}
+	Uint64 state = 0x853c49e6748fea9b_u64;
+	Uint64 sum = 0;
+	const auto beg = now();
+	for (Ulen i = 0; i < n_finds; i++) {
+            if (const auto value = map.find(view(next_random(state) % (n * 2)))) {
+                sum += *value;
+            }
+	}
+	const auto end = now();
+	g_sink = sum;
+	report("hash_map", name, n_finds, end - beg);
+    }
+
+    void hash_map() {
+	static constexpr const Ulen FINDS = 4 << 20;
+	SystemAllocator sys;
+	find_linear("find-8-linear", sys, 8, FINDS);
+	find_hash_map("find-8-hash-map", sys, 8, FINDS);
+	find_linear("find-64-linear", sys, 64, FINDS);
+	find_hash_map("find-64-hash-map", sys, 64, FINDS);
+	find_linear("find-512-linear", sys, 512, FINDS / 4);
+	find_hash_map("find-512-hash-map", sys, 512, FINDS);
+	find_hash_map("find-1m-hash-map", sys, 1 << 20, FINDS);
+	insert("insert-1m", sys, 1 << 20, false);
+	insert("insert-1m-reserved", sys, 1 << 20, true);
+	churn("churn-64k", sys, 64 << 10, FINDS);
+	find_string("find-string-64k", sys, 64 << 10, FINDS);
+    }
+
+} // namespace ctl::bench
@@ -0,0 +1,100 @@
+#include "ctl/allocator.hpp"
+#include "ctl/system.hpp"
+
+#include "bench.hpp"
+
+namespace ctl::bench {
+
+    // Raw Heap, one OS mapping per allocation. This is what SystemAllocator did
+    // before it was backed by size classes.
+    struct RawHeapAllocator : SystemAllocator {
+	virtual Address alloc(Ulen new_len, Bool zero) {
+            return reinterpret_cast<Address>(Heap::allocate(new_len, zero));
+	}
+	virtual void free(Address addr, Ulen old_len) {
+            Heap::deallocate(reinterpret_cast<void*>(addr), old_len);
+	}
+	virtual void shrink(Address, Ulen, Ulen) {
+	}
+	virtual Address grow(Address old_addr, Ulen old_len, Ulen new_len, Bool zero) {
+            const auto new_addr = alloc(new_len, false);
+            if (!new_addr) {
+                return 0;
+            }
+            memcopy(new_addr, old_addr, old_len);
+            if (zero) {
+                memzero(new_addr + old_len, new_len - old_len);
+            }
+            free(old_addr, old_len);
+            return new_addr;
+	}
+    };
+
+    // Allocate N blocks of the given size then free them in reverse, repeated.
+    static void alloc_free(StringView name, Allocator& allocator, Ulen size, Ulen n, Ulen rounds) {
+	SystemAllocator sys;
+	auto addrs = sys.allocate<Address>(n, false);
+	if (!addrs) {
+            return;
+	}
+	const auto beg = now();
+	for (Ulen r = 0; r < rounds; r++) {
+            for (Ulen i = 0; i < n; i++) {
+                addrs[i] = allocator.alloc(size, false);
+            }
+            for (Ulen i = n; i > 0; i--) {
+                allocator.free(addrs[i - 1], size);
+            }
+	}
+	const auto end = now();
+	sys.deallocate(addrs, n);
+
+	InlineAllocator<64> buf;
+	StringBuilder label{buf};
+	label.put(name);
+	label.put('-');
+	label.put(Uint64(size));
+	if (auto result = label.result()) {
+            report("heap", *result, n * rounds * 2, end - beg);
+	}
+    }
+
+    // Grow one buffer from 1 MiB to 256 MiB in 1 MiB steps, touching every new
+    // page like an append-only writer would.
+    static void grow(StringView name, Allocator& allocator) {
+	static constexpr const Ulen STEP = 1 << 20;
+	static constexpr const Ulen MAX  = 256 << 20;
+	auto len  = STEP;
+	auto addr = allocator.alloc(len, false);
+	if (!addr) {
+            return;
+	}
+	const auto beg = now();
+	Ulen ops = 0;
+	for (; len < MAX; len += STEP, ops++) {
+            addr = allocator.grow(addr, len, len + STEP, false);
+            if (!addr) {
+                return;
+            }
+            for (Ulen i = len; i < len + STEP; i += 4096) {
+                reinterpret_cast<volatile Uint8*>(addr)[i] = 1;
+            }
+	}
+	const auto end = now();
+	allocator.free(addr, len);
+	report("heap", name, ops, end - beg);
+    }
+
+    void heap() {
+	static constexpr const Ulen SIZES[] = { 16, 64, 256, 1024, 4096, 16384 };
+	RawHeapAllocator raw;
+	SystemAllocator system;
+	for (const auto size : SIZES) {
+            alloc_free("raw", raw, size, 10'000, 4);
+            alloc_free("system", system, size, 10'000, 64);
+	}
+	grow("raw-grow", raw);
+	grow("system-grow", system);
+    }
+
+} // namespace ctl::bench
@@ -0,0 +1,316 @@
+#include "ctl/info.hpp"
+#include "ctl/system.hpp"
+
+#include "bench.hpp"
+
+#if defined(CTL_HOST_PLATFORM_WINDOWS)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <psapi.h> // GetProcessMemoryInfo
+#else
+#include <time.h> // clock_gettime, CLOCK_MONOTONIC
+#include <pthread.h> // pthread_create, pthread_join
+#include <sys/resource.h> // getrusage
+#include <fcntl.h> // open
+#include <unistd.h> // read, write, close
+#endif
+
+namespace ctl::bench {
+
+    // Set by --csv on the command line.
+    static Bool g_csv = false;
+
+    Uint64 now() {
+#if defined(CTL_HOST_PLATFORM_WINDOWS)
+	LARGE_INTEGER freq, count;
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&count);
+	return Uint64(count.QuadPart) * 1'000'000'000_u64 / Uint64(freq.QuadPart);
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return Uint64(ts.tv_sec) * 1'000'000'000_u64 + Uint64(ts.tv_nsec);
+#endif
+    }
+
+    Uint64 peak_rss() {
+#if defined(CTL_HOST_PLATFORM_WINDOWS)
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof counters)) {
+            return 0;
+	}
+	return Uint64(counters.PeakWorkingSetSize) / 1024;
+#elif defined(CTL_HOST_PLATFORM_LINUX)
+	// VmHWM follows reset_peak_rss, getrusage keeps the lifetime peak.
+	char buf[4096];
+	const auto fd = open("/proc/self/status", O_RDONLY);
+	if (fd < 0) {
+            return 0;
+	}
+	const auto n = read(fd, buf, sizeof buf - 1);
+	close(fd);
+	if (n <= 0) {
+            return 0;
+	}
+	const StringView status{buf, Ulen(n)};
+	const StringView key{"VmHWM:"};
+	for (Ulen i = 0; i + key.length() < status.length(); i++) {
+            if (status.subrange(i, i + key.length()) != key) {
+                continue;
+            }
+            Uint64 kib = 0;
+            for (i += key.length(); i < status.length() && (status[i] == ' ' || status[i] == '\t'); i++);
+            for (; i < status.length() && status[i] >= '0' && status[i] <= '9'; i++) {
+                kib = kib * 10 + Uint64(status[i] - '0');
+            }
+            return kib;
+	}
+	return 0;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) {
+            return 0;
+	}
+	#if defined(CTL_HOST_PLATFORM_MACOS)
+	return Uint64(usage.ru_maxrss) / 1024; // Bytes on macOS
+	#else
+	return Uint64(usage.ru_maxrss);
+	#endif
+#endif
+    }
+
+    void reset_peak_rss() {
+#if defined(CTL_HOST_PLATFORM_LINUX)
+	// Writing 5 to clear_refs resets VmHWM to the current RSS.
+	const auto fd = open("/proc/self/clear_refs", O_WRONLY);
+	if (fd >= 0) {
+            [[maybe_unused]] const auto n = write(fd, "5", 1);
+            close(fd);
+	}
+#endif
+    }
+
+    struct Start {
+	void (*fn)(Ulen, void*);
+	void* data;
+	Ulen  index;
+    };
+
+#if defined(CTL_HOST_PLATFORM_WINDOWS)
+    static DWORD WINAPI thread_main(LPVOID arg) {
+	const auto start = static_cast<Start*>(arg);
+	start->fn(start->index, start->data);
+	return 0;
+    }
+#else
+    static void* thread_main(void* arg) {
+	const auto start = static_cast<Start*>(arg);
+	start->fn(start->index, start->data);
+	return nullptr;
+    }
+#endif
+
+    void run_threads(Ulen n, void (*fn)(Ulen, void*), void* data) {
+	if (n > MAX_THREADS) {
+            n = MAX_THREADS;
+	}
+	Start starts[MAX_THREADS];
+	for (Ulen i = 0; i < n; i++) {
+            starts[i] = { fn, data, i };
+	}
+#if defined(CTL_HOST_PLATFORM_WINDOWS)
+	HANDLE threads[MAX_THREADS];
+	for (Ulen i = 0; i < n; i++) {
+            threads[i] = CreateThread(nullptr, 0, thread_main, &starts[i], 0, nullptr);
+	}
+	for (Ulen i = 0; i < n; i++) {
+            if (threads[i]) {
+                WaitForSingleObject(threads[i], INFINITE);
+                CloseHandle(threads[i]);
+            }
+	}
+#else
+	pthread_t threads[MAX_THREADS];
+	Bool started[MAX_THREADS];
+	for (Ulen i = 0; i < n; i++) {
+            started[i] = pthread_create(&threads[i], nullptr, thread_main, &starts[i]) == 0;
+	}
+	for (Ulen i = 0; i < n; i++) {
+            if (started[i]) {
+                pthread_join(threads[i], nullptr);
+            }
+	}
+#endif
+    }
+
+    Samples::Samples(Allocator& allocator, Ulen capacity)
+	: allocator_{allocator}
+	, data_{allocator.allocate<Float64>(capacity, false)}
+	, capacity_{data_ ? capacity : 0}
+    {
+    }
+
+    Samples::~Samples() {
+	allocator_.deallocate(data_, capacity_);
+    }
+
+    void Samples::add(Uint64 elapsed_ns, Ulen ops) {
+	ops_ += ops;
+	if (length_ < capacity_ && ops) {
+            data_[length_++] = Float64(elapsed_ns) / Float64(ops);
+            sorted_ = false;
+	}
+    }
+
+    void Samples::merge(const Samples& other) {
+	ops_ += other.ops_;
+	for (Ulen i = 0; i < other.length_ && length_ < capacity_; i++) {
+            data_[length_++] = other.data_[i];
+	}
+	sorted_ = false;
+    }
+
+    // Heap sort, the sample counts are too large for anything quadratic.
+    static void sift(Float64* data, Ulen root, Ulen length) {
+	for (;;) {
+            auto child = root * 2 + 1;
+            if (child >= length) {
+                return;
+            }
+            if (child + 1 < length && data[child + 1] > data[child]) {
+                child++;
+            }
+            if (data[root] >= data[child]) {
+                return;
+            }
+            const auto tmp = data[root];
+            data[root] = data[child];
+            data[child] = tmp;
+            root = child;
+	}
+    }
+
+    static void sort(Float64* data, Ulen length) {
+	for (Ulen i = length / 2; i > 0; i--) {
+            sift(data, i - 1, length);
+	}
+	for (Ulen i = length; i > 1; i--) {
+            const auto tmp = data[0];
+            data[0] = data[i - 1];
+            data[i - 1] = tmp;
+            sift(data, 0, i - 1);
+	}
+    }
+
+    Float64 Samples::percentile(Float64 p) {
+	if (length_ == 0) {
+            return 0.0;
+	}
+	if (!sorted_) {
+            sort(data_, length_);
+            sorted_ = true;
+	}
+	auto index = Ulen(p / 100.0 * Float64(length_));
+	if (index >= length_) {
+            index = length_ - 1;
+	}
+	return data_[index];
+    }
+
+    struct Summary {
+	Ulen    ops;
+	Float64 mean;
+	Float64 p50;
+	Float64 p90;
+	Float64 p99;
+	Float64 max;
+    };
+
+    static void emit(StringView suite, StringView name, const Summary& s) {
+	InlineAllocator<1024> buf;
+	StringBuilder line{buf};
+	const auto rss = peak_rss();
+	if (g_csv) {
+            line.put(suite);
+            line.put(',');
+            line.put(name);
+            line.format(",%llu,%.2f,%.2f,%.2f,%.2f,%.2f,%llu\n",
+                        Uint64(s.ops), s.mean, s.p50, s.p90, s.p99, s.max, rss);
+	} else {
+            line.put(suite);
+            line.put('/');
+            line.rpad(32 - suite.length(), name);
+            line.format("%12llu ops %12.2f ns/op  p50 %9.2f  p99 %9.2f  max %11.2f  rss %9llu KiB\n",
+                        Uint64(s.ops), s.mean, s.p50, s.p99, s.max, rss);
+	}
+	if (auto result = line.result()) {
+            Console::print(*result);
+	}
+    }
+
+    void report(StringView suite, StringView name, Ulen ops, Uint64 elapsed_ns) {
+	// A single measurement, every percentile is the mean.
+	const auto mean = ops ? Float64(elapsed_ns) / Float64(ops) : 0.0;
+	emit(suite, name, { ops, mean, mean, mean, mean, mean });
+    }
+
+    void report(StringView suite, StringView name, Samples& samples, Uint64 elapsed_ns) {
+	const auto ops = samples.ops();
+	emit(suite, name, {
+            ops,
+            ops ? Float64(elapsed_ns) / Float64(ops) : 0.0,
+            samples.percentile(50.0),
+            samples.percentile(90.0),
+            samples.percentile(99.0),
+            samples.percentile(100.0),
+	});
+    }
+
+} // namespace ctl::bench
+
+using namespace ctl;
+
+struct Suite {
+    StringView name;
+    void (*run)();
+};
+
+static const Suite SUITES[] = {
+    { "alloc",     bench::alloc },
+    { "array",     bench::array },
+    { "hash_map",  bench::hash_map },
+    { "heap",      bench::heap },
+    { "memory",    bench::memory },
+    { "pool",      bench::pool },
+    { "slab",      bench::slab },
+    { "temporary", bench::temporary },
+};
+
+int main(int argc, char** argv) {
+    // Run every suite, or only the ones named on the command line. --csv
+    // switches to comma separated output with a header line.
+    Ulen n_names = 0;
+    for (int i = 1; i < argc; i++) {
+	if (StringView{argv[i]} == "--csv") {
+            bench::g_csv = true;
+	} else {
+            n_names++;
+	}
+    }
+    if (bench::g_csv) {
+	Console::print("suite,name,ops,ns_per_op,p50_ns,p90_ns,p99_ns,max_ns,peak_rss_kib\n");
+    }
+    for (const auto& suite : SUITES) {
+	Bool run = n_names == 0;
+	for (int i = 1; i < argc; i++) {
+            if (StringView{argv[i]} == suite.name) {
+                run = true;
+            }
+	}
+	if (run) {
+            bench::reset_peak_rss();
+            suite.run();
+	}
+    }
+    return 0;
+}
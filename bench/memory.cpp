@@ -0,0 +1,67 @@
+#include "ctl/allocator.hpp"
+
+#include "bench.hpp"
+
+namespace ctl::bench {
+
+    static void label(StringView op, Ulen size, StringBuilder& out) {
+	out.put(op);
+	out.put('-');
+	if (size >= 1 << 20) {
+            out.put(Uint64(size >> 20));
+            out.put("MiB");
+	} else if (size >= 1 << 10) {
+            out.put(Uint64(size >> 10));
+            out.put("KiB");
+	} else {
+            out.put(Uint64(size));
+            out.put('B');
+	}
+    }
+
+    // memcopy, memmove (overlapping by half) and memzero from 1 B to 64 MiB. Each
+    // size moves about 1 GiB in total so small and large sizes take similar time.
+    void memory() {
+	static constexpr const Ulen MAX = 64 << 20;
+	SystemAllocator sys;
+	const auto src = sys.alloc(MAX, true);
+	const auto dst = sys.alloc(MAX + MAX / 2, true);
+	if (!src || !dst) {
+            return;
+	}
+	for (Ulen size = 1; size <= MAX; size *= 4) {
+            auto rounds = (1_ulen << 30) / size;
+            if (rounds > 10'000'000) rounds = 10'000'000;
+            if (rounds < 8) rounds = 8;
+
+            InlineAllocator<64> buf;
+            StringBuilder name{buf};
+
+            auto beg = now();
+            for (Ulen i = 0; i < rounds; i++) {
+                Allocator::memcopy(dst, src, size);
+            }
+            label("memcopy", size, name);
+            report("memory", *name.result(), rounds, now() - beg);
+
+            beg = now();
+            for (Ulen i = 0; i < rounds; i++) {
+                Allocator::memmove(dst + size / 2, dst, size);
+            }
+            name.clear();
+            label("memmove", size, name);
+            report("memory", *name.result(), rounds, now() - beg);
+
+            beg = now();
+            for (Ulen i = 0; i < rounds; i++) {
+                Allocator::memzero(dst, size);
+            }
+            name.clear();
+            label("memzero", size, name);
+            report("memory", *name.result(), rounds, now() - beg);
+	}
+	sys.free(dst, MAX + MAX / 2);
+	sys.free(src, MAX);
+    }
+
+} // namespace ctl::bench
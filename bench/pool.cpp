@@ -0,0 +1,186 @@
+#include "ctl/pool.hpp"
+#include "ctl/stream.hpp"
+
+#include "bench.hpp"
+
+namespace ctl::bench {
+
+    // Every thread repeatedly fills a window of slots, touches them and frees
+    // them again. Throughput should scale with the thread count as long as the
+    // threads do not fight over the same bitmap words.
+    static inline constexpr const Ulen WINDOW  = 256;   // Live slots per thread
+    static inline constexpr const Ulen ROUNDS  = 4096;
+    static inline constexpr const Ulen SIZE    = 64;
+    static inline constexpr const Ulen THREADS[] = { 1, 2, 4, 8, 16 };
+    static inline constexpr const Ulen OCCUPANCY[] = { 5, 50, 100 }; // % of live slots in snapshots
+
+    // One shared Pool behind a lock, the baseline.
+    struct LockedSubject {
+	LockedSubject(Allocator& allocator, Ulen capacity) : pool_{Pool::create(allocator, SIZE, capacity)} {}
+	Maybe<PoolRef> allocate() {
+            lock_.lock();
+            auto ref = pool_->allocate();
+            lock_.unlock();
+            return ref;
+	}
+	void deallocate(PoolRef ref) {
+            lock_.lock();
+            pool_->deallocate(ref);
+            lock_.unlock();
+	}
+	Uint8* operator[](PoolRef ref) { return (*pool_)[ref]; }
+	Bool is_valid() const { return pool_.is_valid(); }
+	Maybe<Pool> pool_;
+	SpinLock    lock_;
+    };
+
+    struct ConcurrentSubject {
+	ConcurrentSubject(Allocator& allocator, Ulen capacity) : pool_{ConcurrentPool::create(allocator, SIZE, capacity)} {}
+	Maybe<PoolRef> allocate() { return pool_->allocate(); }
+	void deallocate(PoolRef ref) { pool_->deallocate(ref); }
+	Uint8* operator[](PoolRef ref) { return (*pool_)[ref]; }
+	Bool is_valid() const { return pool_.is_valid(); }
+	Maybe<ConcurrentPool> pool_;
+    };
+
+    template<typename S>
+    struct Shared {
+	static void run(Ulen, void* data) {
+            const auto self = static_cast<Shared*>(data);
+            PoolRef refs[WINDOW];
+            for (Ulen round = 0; round < ROUNDS; round++) {
+                for (Ulen i = 0; i < WINDOW; i++) {
+                    auto ref = self->subject->allocate();
+                    if (!ref) {
+                        self->failed.store(1, MemoryOrder::RELAXED);
+                        return;
+                    }
+                    *(*self->subject)[*ref] = Uint8(i);
+                    refs[i] = *ref;
+                }
+                for (Ulen i = 0; i < WINDOW; i++) {
+                    self->subject->deallocate(refs[i]);
+                }
+            }
+	}
+	S*             subject;
+	Atomic<Uint32> failed;
+    };
+
+    template<typename S>
+    static void run(StringView name, Ulen n_threads) {
+	SystemAllocator sys;
+	// Room for every window twice over so a full pool never limits a thread.
+	S subject{sys, 2 * WINDOW * n_threads};
+	if (!subject.is_valid()) {
+            return;
+	}
+	Shared<S> state;
+	state.subject = &subject;
+	const auto beg = now();
+	run_threads(n_threads, Shared<S>::run, &state);
+	const auto end = now();
+	InlineAllocator<128> buf;
+	StringBuilder out{buf};
+	out.put(name);
+	out.put(state.failed.load() ? StringView{"-failed-"} : StringView{"-"});
+	out.put(Uint64(n_threads));
+	if (auto result = out.result()) {
+            // Alloc + free of every slot over the wall clock of all threads.
+            report("pool", *result, 2 * WINDOW * ROUNDS * n_threads, end - beg);
+	}
+    }
+
+    // Snapshot to memory, so the timings are the formats and not the disk.
+    struct MemoryStream : Stream {
+	MemoryStream(Allocator& allocator) : data_{allocator} {}
+	virtual Ulen write(Slice<const Uint8> data) {
+            const auto offset = data_.length();
+            if (!data_.resize(offset + data.length())) {
+                return 0;
+            }
+            Allocator::memcopy(Address(data_.data() + offset), Address(data.data()), data.length());
+            return data.length();
+	}
+	virtual Ulen read(Slice<Uint8> data) {
+            const auto left = data_.length() - offset_;
+            const auto nb = data.length() < left ? data.length() : left;
+            Allocator::memcopy(Address(data.data()), Address(data_.data() + offset_), nb);
+            offset_ += nb;
+            return nb;
+	}
+	virtual Uint64 tell() const { return offset_; }
+	Array<Uint8> data_;
+	Ulen         offset_ = 0;
+    };
+
+    // Save and load a pool with `percent` of its slots live at random, in both
+    // formats. The snapshot size is part of the name.
+    static void snapshot(Ulen percent) {
+	static constexpr const Ulen CAPACITY = 1 << 20; // 64 MiB of 64 byte objects
+	SystemAllocator sys;
+	auto pool = Pool::create(sys, SIZE, CAPACITY);
+	if (!pool) {
+            return;
+	}
+	while (pool->allocate());
+	Uint64 state = 0x853c49e6748fea9b_u64;
+	for (Uint32 i = 0; i < CAPACITY; i++) {
+            state = state * 6364136223846793005_u64 + 1442695040888963407_u64;
+            if ((state >> 33) % 100 >= percent) {
+                pool->deallocate(PoolRef { i });
+            } else {
+                *(*pool)[PoolRef { i }] = Uint8(i);
+            }
+	}
+	const struct { StringView name; Pool::Format format; } formats[] = {
+            { "dense",  Pool::Format::DENSE },
+            { "sparse", Pool::Format::SPARSE },
+	};
+	for (const auto& format : formats) {
+            MemoryStream stream{sys};
+            if (!stream.data_.reserve(CAPACITY * (SIZE + 8))) {
+                return;
+            }
+            auto beg = now();
+            const auto saved = pool->save(stream, format.format);
+            auto end = now();
+            if (!saved) {
+                return;
+            }
+            const auto size_kib = Uint64(stream.data_.length() >> 10);
+            auto emit = [&](StringView op, Uint64 elapsed) {
+                InlineAllocator<128> buf;
+                StringBuilder out{buf};
+                out.put(op);
+                out.put(format.name);
+                out.put('-');
+                out.put(Uint64(percent));
+                out.put(StringView{"pct-"});
+                out.put(size_kib);
+                out.put(StringView{"KiB"});
+                if (auto result = out.result()) {
+                    report("pool", *result, CAPACITY, elapsed);
+                }
+            };
+            emit("save-", end - beg);
+            beg = now();
+            auto loaded = Pool::load(sys, stream);
+            end = now();
+            emit(loaded ? StringView{"load-"} : StringView{"load-failed-"}, end - beg);
+	}
+    }
+
+    void pool() {
+	for (const auto n_threads : THREADS) {
+            run<LockedSubject>("locked", n_threads);
+	}
+	for (const auto n_threads : THREADS) {
+            run<ConcurrentSubject>("concurrent", n_threads);
+	}
+	for (const auto percent : OCCUPANCY) {
+            snapshot(percent);
+	}
+    }
+
+} // namespace ctl::bench
@@ -0,0 +1,291 @@
+#include "ctl/slab.hpp"
+
+#include "bench.hpp"
+
+namespace ctl::bench {
+
+    static volatile Uint64 g_sink;
+
+    // Fill a slab well past what the TLB covers with 4 KiB pages, then read
+    // objects at random. Each read is a likely TLB miss unless the pools are
+    // backed by huge pages.
+    static void random_access(StringView name, Allocator& allocator, Ulen n_objects, Ulen n_reads) {
+	static constexpr const Ulen SIZE     = 64;
+	static constexpr const Ulen CAPACITY = (2 << 20) / SIZE; // 2 MiB of objects per pool
+	Slab slab{allocator, SIZE, CAPACITY};
+	for (Ulen i = 0; i < n_objects; i++) {
+            auto ref = slab.allocate();
+            if (!ref) {
+                return;
+            }
+            *slab[*ref] = Uint8(i);
+	}
+	// Every index depends on the byte read before it, so the reads cannot
+	// overlap and each one pays the full miss latency.
+	Uint64 state = 0x853c49e6748fea9b_u64;
+	const auto beg = now();
+	for (Ulen i = 0; i < n_reads; i++) {
+            state = state * 6364136223846793005_u64 + 1442695040888963407_u64;
+            const auto index = Uint32((state >> 32) % n_objects);
+            state += *slab[SlabRef { index }];
+	}
+	const auto end = now();
+	g_sink = state;
+	report("slab", name, n_reads, end - beg);
+    }
+
+    // Update loop over a slab with half of its objects destroyed at random:
+    // once through a separate array of live handles, the way callers had to
+    // do it, and once with for_each walking the pool bitmaps.
+    static void iterate(Allocator& allocator, Ulen n_objects) {
+	struct Particle {
+            Float32 x, y, z;
+            Float32 vx, vy, vz;
+            Uint32  id;
+	};
+	TypedSlab<Particle> slab{allocator, 4096};
+	Array<SlabHandle<Particle>> handles{allocator};
+	Uint64 state = 0x853c49e6748fea9b_u64;
+	for (Ulen i = 0; i < n_objects; i++) {
+            auto handle = slab.emplace(0.0f, 0.0f, 0.0f, 1.0f, 2.0f, 3.0f, Uint32(i));
+            if (!handle || !handles.push_back(*handle)) {
+                return;
+            }
+	}
+	Ulen n_live = 0;
+	for (Ulen i = 0; i < n_objects; i++) {
+            state = state * 6364136223846793005_u64 + 1442695040888963407_u64;
+            if ((state >> 63) != 0) {
+                slab.destroy(handles[i]);
+            } else {
+                handles[n_live++] = handles[i];
+            }
+	}
+	handles.resize(n_live);
+	static constexpr const Ulen PASSES = 16;
+	auto beg = now();
+	for (Ulen pass = 0; pass < PASSES; pass++) {
+            for (const auto handle : handles) {
+                auto& particle = *slab[handle];
+                particle.x += particle.vx;
+                particle.y += particle.vy;
+                particle.z += particle.vz;
+            }
+	}
+	auto end = now();
+	report("slab", "iterate-handles", n_live * PASSES, end - beg);
+	beg = now();
+	for (Ulen pass = 0; pass < PASSES; pass++) {
+            slab.for_each([](SlabHandle<Particle>, Particle& particle) {
+                particle.x += particle.vx;
+                particle.y += particle.vy;
+                particle.z += particle.vz;
+            });
+	}
+	end = now();
+	report("slab", "iterate-for-each", n_live * PASSES, end - beg);
+    }
+
+    // Churn a slab down to ~3% occupancy spread over every pool, then compact
+    // it a bounded step at a time, the way a frame loop would. Reports the
+    // cost per moved object and a walk over the live objects before and after.
+    static void compact(Allocator& allocator, Ulen n_objects) {
+	static constexpr const Ulen SIZE     = 64;
+	static constexpr const Ulen CAPACITY = 1024;
+	static constexpr const Ulen STEP     = 256; // Moves per compact() call
+	Slab slab{allocator, SIZE, CAPACITY};
+	Array<SlabRef> refs{allocator};
+	if (!refs.resize(n_objects) || slab.allocate_n(refs.slice()) != n_objects) {
+            return;
+	}
+	Uint64 state = 0x853c49e6748fea9b_u64;
+	for (const auto ref : refs) {
+            state = state * 6364136223846793005_u64 + 1442695040888963407_u64;
+            if ((state >> 32) % 32 != 0) {
+                slab.deallocate(ref);
+            } else {
+                *slab[ref] = Uint8(state);
+            }
+	}
+	const auto walk = [&](StringView name) {
+            Uint64 sum = 0;
+            Ulen n_live = 0;
+            const auto beg = now();
+            slab.for_each([&](SlabRef ref) { sum += *slab[ref]; n_live++; });
+            const auto end = now();
+            g_sink = sum;
+            report("slab", name, n_live, end - beg);
+	};
+	walk("compact-walk-before");
+	SlabMove moves[STEP];
+	Ulen n_moved = 0;
+	const auto beg = now();
+	while (const auto n = slab.compact(Slice{moves, STEP})) {
+            n_moved += n;
+	}
+	const auto end = now();
+	report("slab", "compact", n_moved, end - beg);
+	slab.trim();
+	walk("compact-walk-after");
+    }
+
+    // Dependent lookups over a cache resident slab, so the index math and the
+    // pool table are what is measured rather than the memory behind them.
+    template<typename S>
+    static void lookup(StringView name, S& slab, Ulen n_objects, Ulen n_reads) {
+	for (Ulen i = 0; i < n_objects; i++) {
+            auto ref = slab.allocate();
+            if (!ref) {
+                return;
+            }
+            *slab[*ref] = Uint8(i);
+	}
+	Uint64 state = 0x853c49e6748fea9b_u64;
+	const auto beg = now();
+	for (Ulen i = 0; i < n_reads; i++) {
+            state = state * 6364136223846793005_u64 + 1442695040888963407_u64;
+            const auto index = Uint32((state >> 40) & (n_objects - 1));
+            state += *slab[SlabRef { index }];
+	}
+	const auto end = now();
+	g_sink = state;
+	report("slab", name, n_reads, end - beg);
+    }
+
+    // Every thread repeatedly fills a window of objects and frees a window. In
+    // the remote runs a thread swaps the window it filled with the one in a
+    // shared mailbox and frees that, so most frees are of objects another
+    // thread allocated.
+    static inline constexpr const Ulen WINDOW    = 256;
+    static inline constexpr const Ulen ROUNDS    = 2048;
+    static inline constexpr const Ulen THREADS[] = { 1, 2, 4, 8, 16 };
+
+    // One shared Slab behind a lock, the baseline.
+    struct LockedSubject {
+	LockedSubject(Allocator& allocator) : slab_{allocator, 64, 4096} {}
+	Maybe<SlabRef> allocate() {
+            lock_.lock();
+            auto ref = slab_.allocate();
+            lock_.unlock();
+            return ref;
+	}
+	void deallocate(SlabRef ref) {
+            lock_.lock();
+            slab_.deallocate(ref);
+            lock_.unlock();
+	}
+	Uint8* operator[](SlabRef ref) {
+            lock_.lock();
+            auto address = slab_[ref];
+            lock_.unlock();
+            return address;
+	}
+	void release() {}
+	Slab     slab_;
+	SpinLock lock_;
+    };
+
+    struct ShardedSubject {
+	ShardedSubject(Allocator& allocator) : slab_{allocator, 64, 4096} {}
+	Maybe<SlabRef> allocate() { return slab_.allocate(); }
+	void deallocate(SlabRef ref) { slab_.deallocate(ref); }
+	Uint8* operator[](SlabRef ref) { return slab_[ref]; }
+	void release() { slab_.release(); }
+	ShardedSlab slab_;
+    };
+
+    template<typename S>
+    struct Threaded {
+	struct Window {
+            SlabRef refs[WINDOW];
+	};
+	static void run(Ulen index, void* data) {
+            const auto self = static_cast<Threaded*>(data);
+            auto window = &self->windows[2 * index];
+            for (Ulen round = 0; round < ROUNDS; round++) {
+                for (Ulen i = 0; i < WINDOW; i++) {
+                    auto ref = self->subject->allocate();
+                    if (!ref) {
+                        self->failed.store(1, MemoryOrder::RELAXED);
+                        return;
+                    }
+                    *(*self->subject)[*ref] = Uint8(i);
+                    window->refs[i] = *ref;
+                }
+                if (self->remote) {
+                    window = self->mailbox.exchange(window, MemoryOrder::ACQ_REL);
+                    if (!window) {
+                        // Nothing to free yet, fill the spare next round.
+                        window = &self->windows[2 * index + 1];
+                        continue;
+                    }
+                }
+                for (Ulen i = 0; i < WINDOW; i++) {
+                    self->subject->deallocate(window->refs[i]);
+                }
+            }
+            self->subject->release();
+	}
+	S*              subject;
+	Window          windows[2 * MAX_THREADS];
+	Atomic<Window*> mailbox = nullptr;
+	Atomic<Uint32>  failed  = 0;
+	Bool            remote  = false;
+    };
+
+    template<typename S>
+    static void threaded(StringView name, Ulen n_threads, Bool remote) {
+	SystemAllocator sys;
+	S subject{sys};
+	auto state = sys.create<Threaded<S>>();
+	if (!state) {
+            return;
+	}
+	state->subject = &subject;
+	state->remote = remote;
+	const auto beg = now();
+	run_threads(n_threads, Threaded<S>::run, state);
+	const auto end = now();
+	InlineAllocator<128> buf;
+	StringBuilder out{buf};
+	out.put(name);
+	out.put(remote ? StringView{"-remote"} : StringView{"-local"});
+	out.put(state->failed.load() ? StringView{"-failed-"} : StringView{"-"});
+	out.put(Uint64(n_threads));
+	if (auto result = out.result()) {
+            // Alloc + free of every object over the wall clock of all threads.
+            report("slab", *result, 2 * WINDOW * ROUNDS * n_threads, end - beg);
+	}
+	sys.destroy(state);
+    }
+
+    void slab() {
+	static constexpr const Ulen OBJECTS = 4 << 20; // 256 MiB of 64 byte objects
+	static constexpr const Ulen READS   = 10'000'000;
+	SystemAllocator small_pages;
+	SystemAllocator huge_pages{true};
+	random_access("random-4k", small_pages, OBJECTS, READS);
+	random_access("random-huge", huge_pages, OBJECTS, READS);
+	iterate(small_pages, 1 << 20);
+	compact(small_pages, 1 << 20);
+	{
+            static constexpr const Ulen SIZE     = 16;
+            static constexpr const Ulen CAPACITY = 1024;
+            static constexpr const Ulen LOOKUPS  = 32 << 10; // 512 KiB of objects
+            Slab runtime{small_pages, SIZE, CAPACITY};
+            StaticSlab<SIZE, CAPACITY> compiled{small_pages};
+            lookup("lookup-runtime", runtime, LOOKUPS, READS);
+            lookup("lookup-static", compiled, LOOKUPS, READS);
+            if (auto contiguous = VirtualSlab::create(small_pages, SIZE, CAPACITY, LOOKUPS)) {
+                lookup("lookup-virtual", *contiguous, LOOKUPS, READS);
+            }
+	}
+	for (const auto n_threads : THREADS) {
+            threaded<LockedSubject>("locked", n_threads, false);
+            threaded<ShardedSubject>("sharded", n_threads, false);
+            threaded<LockedSubject>("locked", n_threads, true);
+            threaded<ShardedSubject>("sharded", n_threads, true);
+	}
+    }
+
+} // namespace ctl::bench
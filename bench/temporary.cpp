@@ -0,0 +1,43 @@
+#include "ctl/allocator.hpp"
+
+#include "bench.hpp"
+
+namespace ctl::bench {
+
+    // Shrink and grow back the allocation at the top of each block. Every block
+    // holds one allocation, so finding the owning block dominates the cost.
+    static void resize(StringView name, Ulen n_blocks, Ulen rounds) {
+	static constexpr const Ulen LEN = 3 << 19; // 1.5 MiB, one per 2 MiB block
+	SystemAllocator sys;
+	TemporaryAllocator temporary{sys};
+	auto addrs = sys.allocate<Address>(n_blocks, false);
+	if (!addrs) {
+            return;
+	}
+	for (Ulen i = 0; i < n_blocks; i++) {
+            addrs[i] = temporary.alloc(LEN, false);
+            if (!addrs[i]) {
+                sys.deallocate(addrs, n_blocks);
+                return;
+            }
+	}
+	const auto beg = now();
+	for (Ulen r = 0; r < rounds; r++) {
+            for (Ulen i = 0; i < n_blocks; i++) {
+                temporary.shrink(addrs[i], LEN, LEN - 64);
+                addrs[i] = temporary.grow(addrs[i], LEN - 64, LEN, false);
+            }
+	}
+	const auto end = now();
+	sys.deallocate(addrs, n_blocks);
+	report("temporary", name, n_blocks * rounds * 2, end - beg);
+    }
+
+    void temporary() {
+	resize("resize-1", 1, 100'000);
+	resize("resize-16", 16, 10'000);
+	resize("resize-128", 128, 1'000);
+	resize("resize-512", 512, 250);
+    }
+
+} // namespace ctl::bench
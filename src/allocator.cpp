@@ -1,12 +1,20 @@
 #include "ctl/allocator.hpp"
 #include "ctl/system.hpp"
+#include "ctl/atomic.hpp"
 
 #if defined(CTL_CFG_USE_MALLOC)
 #include <string.h>
 #endif
 
 #if defined(CTL_ARCH_X64)
-    #include <emmintrin.h>
+    #include <immintrin.h>
+    #if defined(CTL_COMPILER_MSVC)
+        #include <intrin.h>
+        #define CTL_TARGET(...)
+    #else
+        #include <cpuid.h>
+        #define CTL_TARGET(...) __attribute__((target(__VA_ARGS__)))
+    #endif
     #pragma message("INFO: Using SIMD x86_64")
 #elif defined(CTL_ARCH_ARM64)
     #include <arm_neon.h>
@@ -46,6 +54,369 @@ namespace ctl {
 
 #define ASSERT(...)
 
+#if defined(CTL_ARCH_X64)
+    // Runtime dispatched memory kernels.
+    //
+    // The SSE2 kernels are the x86_64 baseline. AVX2 and AVX-512 variants are
+    // selected on first use from CPUID, provided the OS saves the wider register
+    // state (XGETBV). Requests below DISPATCH_MIN stay on the inline SSE2 code in
+    // memcopy/memzero. Requests of at least STREAM_THRESHOLD bytes use the
+    // *_stream kernels, whose non-temporal stores bypass the cache so copying
+    // megabytes during a grow does not evict the working set.
+    //
+    // copy is safe for overlapping ranges when dst <= src (the tail vector is
+    // loaded before any store), copy_backward when dst >= src. Every kernel
+    // requires len to be at least one vector.
+    static constexpr const Ulen DISPATCH_MIN     = 128;
+    static constexpr const Ulen STREAM_THRESHOLD = 4 << 20;
+
+    struct MemoryKernels {
+        void (*copy)(Uint8* dst, const Uint8* src, Ulen len);
+        void (*copy_backward)(Uint8* dst, const Uint8* src, Ulen len);
+        void (*copy_stream)(Uint8* dst, const Uint8* src, Ulen len);
+        void (*zero)(Uint8* dst, Ulen len);
+        void (*zero_stream)(Uint8* dst, Ulen len);
+    };
+
+    // --- SSE2 ---
+    static void copy_sse2(Uint8* dst, const Uint8* src, Ulen len) {
+        using V = __m128i;
+        const V tail = _mm_loadu_si128(reinterpret_cast<const V*>(src + len - 16));
+        Ulen i = 0;
+        for (; i + 64 <= len; i += 64) {
+            const V a = _mm_loadu_si128(reinterpret_cast<const V*>(src + i));
+            const V b = _mm_loadu_si128(reinterpret_cast<const V*>(src + i + 16));
+            const V c = _mm_loadu_si128(reinterpret_cast<const V*>(src + i + 32));
+            const V d = _mm_loadu_si128(reinterpret_cast<const V*>(src + i + 48));
+            _mm_storeu_si128(reinterpret_cast<V*>(dst + i),      a);
+            _mm_storeu_si128(reinterpret_cast<V*>(dst + i + 16), b);
+            _mm_storeu_si128(reinterpret_cast<V*>(dst + i + 32), c);
+            _mm_storeu_si128(reinterpret_cast<V*>(dst + i + 48), d);
+        }
+        for (; i + 16 <= len; i += 16) {
+            _mm_storeu_si128(reinterpret_cast<V*>(dst + i), _mm_loadu_si128(reinterpret_cast<const V*>(src + i)));
+        }
+        _mm_storeu_si128(reinterpret_cast<V*>(dst + len - 16), tail);
+    }
+
+    static void copy_backward_sse2(Uint8* dst, const Uint8* src, Ulen len) {
+        using V = __m128i;
+        const V head = _mm_loadu_si128(reinterpret_cast<const V*>(src));
+        Ulen i = len;
+        while (i >= 64) {
+            i -= 64;
+            const V a = _mm_loadu_si128(reinterpret_cast<const V*>(src + i));
+            const V b = _mm_loadu_si128(reinterpret_cast<const V*>(src + i + 16));
+            const V c = _mm_loadu_si128(reinterpret_cast<const V*>(src + i + 32));
+            const V d = _mm_loadu_si128(reinterpret_cast<const V*>(src + i + 48));
+            _mm_storeu_si128(reinterpret_cast<V*>(dst + i),      a);
+            _mm_storeu_si128(reinterpret_cast<V*>(dst + i + 16), b);
+            _mm_storeu_si128(reinterpret_cast<V*>(dst + i + 32), c);
+            _mm_storeu_si128(reinterpret_cast<V*>(dst + i + 48), d);
+        }
+        while (i >= 16) {
+            i -= 16;
+            _mm_storeu_si128(reinterpret_cast<V*>(dst + i), _mm_loadu_si128(reinterpret_cast<const V*>(src + i)));
+        }
+        _mm_storeu_si128(reinterpret_cast<V*>(dst), head);
+    }
+
+    static void copy_stream_sse2(Uint8* dst, const Uint8* src, Ulen len) {
+        using V = __m128i;
+        // Unaligned head, then whole aligned vectors.
+        _mm_storeu_si128(reinterpret_cast<V*>(dst), _mm_loadu_si128(reinterpret_cast<const V*>(src)));
+        Ulen i = 16 - (reinterpret_cast<Address>(dst) & 15);
+        for (; i + 64 <= len; i += 64) {
+            const V a = _mm_loadu_si128(reinterpret_cast<const V*>(src + i));
+            const V b = _mm_loadu_si128(reinterpret_cast<const V*>(src + i + 16));
+            const V c = _mm_loadu_si128(reinterpret_cast<const V*>(src + i + 32));
+            const V d = _mm_loadu_si128(reinterpret_cast<const V*>(src + i + 48));
+            _mm_stream_si128(reinterpret_cast<V*>(dst + i),      a);
+            _mm_stream_si128(reinterpret_cast<V*>(dst + i + 16), b);
+            _mm_stream_si128(reinterpret_cast<V*>(dst + i + 32), c);
+            _mm_stream_si128(reinterpret_cast<V*>(dst + i + 48), d);
+        }
+        _mm_sfence();
+        copy_sse2(dst + len - 64, src + len - 64, 64);
+    }
+
+    static void zero_sse2(Uint8* dst, Ulen len) {
+        using V = __m128i;
+        const V zero = _mm_setzero_si128();
+        Ulen i = 0;
+        for (; i + 64 <= len; i += 64) {
+            _mm_storeu_si128(reinterpret_cast<V*>(dst + i),      zero);
+            _mm_storeu_si128(reinterpret_cast<V*>(dst + i + 16), zero);
+            _mm_storeu_si128(reinterpret_cast<V*>(dst + i + 32), zero);
+            _mm_storeu_si128(reinterpret_cast<V*>(dst + i + 48), zero);
+        }
+        for (; i + 16 <= len; i += 16) {
+            _mm_storeu_si128(reinterpret_cast<V*>(dst + i), zero);
+        }
+        _mm_storeu_si128(reinterpret_cast<V*>(dst + len - 16), zero);
+    }
+
+    static void zero_stream_sse2(Uint8* dst, Ulen len) {
+        using V = __m128i;
+        const V zero = _mm_setzero_si128();
+        _mm_storeu_si128(reinterpret_cast<V*>(dst), zero);
+        Ulen i = 16 - (reinterpret_cast<Address>(dst) & 15);
+        for (; i + 64 <= len; i += 64) {
+            _mm_stream_si128(reinterpret_cast<V*>(dst + i),      zero);
+            _mm_stream_si128(reinterpret_cast<V*>(dst + i + 16), zero);
+            _mm_stream_si128(reinterpret_cast<V*>(dst + i + 32), zero);
+            _mm_stream_si128(reinterpret_cast<V*>(dst + i + 48), zero);
+        }
+        _mm_sfence();
+        zero_sse2(dst + len - 64, 64);
+    }
+
+    // --- AVX2 ---
+    CTL_TARGET("avx2") static void copy_avx2(Uint8* dst, const Uint8* src, Ulen len) {
+        using V = __m256i;
+        const V tail = _mm256_loadu_si256(reinterpret_cast<const V*>(src + len - 32));
+        Ulen i = 0;
+        for (; i + 128 <= len; i += 128) {
+            const V a = _mm256_loadu_si256(reinterpret_cast<const V*>(src + i));
+            const V b = _mm256_loadu_si256(reinterpret_cast<const V*>(src + i + 32));
+            const V c = _mm256_loadu_si256(reinterpret_cast<const V*>(src + i + 64));
+            const V d = _mm256_loadu_si256(reinterpret_cast<const V*>(src + i + 96));
+            _mm256_storeu_si256(reinterpret_cast<V*>(dst + i),      a);
+            _mm256_storeu_si256(reinterpret_cast<V*>(dst + i + 32), b);
+            _mm256_storeu_si256(reinterpret_cast<V*>(dst + i + 64), c);
+            _mm256_storeu_si256(reinterpret_cast<V*>(dst + i + 96), d);
+        }
+        for (; i + 32 <= len; i += 32) {
+            _mm256_storeu_si256(reinterpret_cast<V*>(dst + i), _mm256_loadu_si256(reinterpret_cast<const V*>(src + i)));
+        }
+        _mm256_storeu_si256(reinterpret_cast<V*>(dst + len - 32), tail);
+    }
+
+    CTL_TARGET("avx2") static void copy_backward_avx2(Uint8* dst, const Uint8* src, Ulen len) {
+        using V = __m256i;
+        const V head = _mm256_loadu_si256(reinterpret_cast<const V*>(src));
+        Ulen i = len;
+        while (i >= 128) {
+            i -= 128;
+            const V a = _mm256_loadu_si256(reinterpret_cast<const V*>(src + i));
+            const V b = _mm256_loadu_si256(reinterpret_cast<const V*>(src + i + 32));
+            const V c = _mm256_loadu_si256(reinterpret_cast<const V*>(src + i + 64));
+            const V d = _mm256_loadu_si256(reinterpret_cast<const V*>(src + i + 96));
+            _mm256_storeu_si256(reinterpret_cast<V*>(dst + i),      a);
+            _mm256_storeu_si256(reinterpret_cast<V*>(dst + i + 32), b);
+            _mm256_storeu_si256(reinterpret_cast<V*>(dst + i + 64), c);
+            _mm256_storeu_si256(reinterpret_cast<V*>(dst + i + 96), d);
+        }
+        while (i >= 32) {
+            i -= 32;
+            _mm256_storeu_si256(reinterpret_cast<V*>(dst + i), _mm256_loadu_si256(reinterpret_cast<const V*>(src + i)));
+        }
+        _mm256_storeu_si256(reinterpret_cast<V*>(dst), head);
+    }
+
+    CTL_TARGET("avx2") static void copy_stream_avx2(Uint8* dst, const Uint8* src, Ulen len) {
+        using V = __m256i;
+        _mm256_storeu_si256(reinterpret_cast<V*>(dst), _mm256_loadu_si256(reinterpret_cast<const V*>(src)));
+        Ulen i = 32 - (reinterpret_cast<Address>(dst) & 31);
+        for (; i + 128 <= len; i += 128) {
+            const V a = _mm256_loadu_si256(reinterpret_cast<const V*>(src + i));
+            const V b = _mm256_loadu_si256(reinterpret_cast<const V*>(src + i + 32));
+            const V c = _mm256_loadu_si256(reinterpret_cast<const V*>(src + i + 64));
+            const V d = _mm256_loadu_si256(reinterpret_cast<const V*>(src + i + 96));
+            _mm256_stream_si256(reinterpret_cast<V*>(dst + i),      a);
+            _mm256_stream_si256(reinterpret_cast<V*>(dst + i + 32), b);
+            _mm256_stream_si256(reinterpret_cast<V*>(dst + i + 64), c);
+            _mm256_stream_si256(reinterpret_cast<V*>(dst + i + 96), d);
+        }
+        _mm_sfence();
+        copy_avx2(dst + len - 128, src + len - 128, 128);
+    }
+
+    CTL_TARGET("avx2") static void zero_avx2(Uint8* dst, Ulen len) {
+        using V = __m256i;
+        const V zero = _mm256_setzero_si256();
+        Ulen i = 0;
+        for (; i + 128 <= len; i += 128) {
+            _mm256_storeu_si256(reinterpret_cast<V*>(dst + i),      zero);
+            _mm256_storeu_si256(reinterpret_cast<V*>(dst + i + 32), zero);
+            _mm256_storeu_si256(reinterpret_cast<V*>(dst + i + 64), zero);
+            _mm256_storeu_si256(reinterpret_cast<V*>(dst + i + 96), zero);
+        }
+        for (; i + 32 <= len; i += 32) {
+            _mm256_storeu_si256(reinterpret_cast<V*>(dst + i), zero);
+        }
+        _mm256_storeu_si256(reinterpret_cast<V*>(dst + len - 32), zero);
+    }
+
+    CTL_TARGET("avx2") static void zero_stream_avx2(Uint8* dst, Ulen len) {
+        using V = __m256i;
+        const V zero = _mm256_setzero_si256();
+        _mm256_storeu_si256(reinterpret_cast<V*>(dst), zero);
+        Ulen i = 32 - (reinterpret_cast<Address>(dst) & 31);
+        for (; i + 128 <= len; i += 128) {
+            _mm256_stream_si256(reinterpret_cast<V*>(dst + i),      zero);
+            _mm256_stream_si256(reinterpret_cast<V*>(dst + i + 32), zero);
+            _mm256_stream_si256(reinterpret_cast<V*>(dst + i + 64), zero);
+            _mm256_stream_si256(reinterpret_cast<V*>(dst + i + 96), zero);
+        }
+        _mm_sfence();
+        zero_avx2(dst + len - 128, 128);
+    }
+
+    // --- AVX-512 ---
+    CTL_TARGET("avx512f") static void copy_avx512(Uint8* dst, const Uint8* src, Ulen len) {
+        using V = __m512i;
+        const V tail = _mm512_loadu_si512(src + len - 64);
+        Ulen i = 0;
+        for (; i + 256 <= len; i += 256) {
+            const V a = _mm512_loadu_si512(src + i);
+            const V b = _mm512_loadu_si512(src + i + 64);
+            const V c = _mm512_loadu_si512(src + i + 128);
+            const V d = _mm512_loadu_si512(src + i + 192);
+            _mm512_storeu_si512(dst + i,       a);
+            _mm512_storeu_si512(dst + i + 64,  b);
+            _mm512_storeu_si512(dst + i + 128, c);
+            _mm512_storeu_si512(dst + i + 192, d);
+        }
+        for (; i + 64 <= len; i += 64) {
+            _mm512_storeu_si512(dst + i, _mm512_loadu_si512(src + i));
+        }
+        _mm512_storeu_si512(dst + len - 64, tail);
+    }
+
+    CTL_TARGET("avx512f") static void copy_backward_avx512(Uint8* dst, const Uint8* src, Ulen len) {
+        using V = __m512i;
+        const V head = _mm512_loadu_si512(src);
+        Ulen i = len;
+        while (i >= 256) {
+            i -= 256;
+            const V a = _mm512_loadu_si512(src + i);
+            const V b = _mm512_loadu_si512(src + i + 64);
+            const V c = _mm512_loadu_si512(src + i + 128);
+            const V d = _mm512_loadu_si512(src + i + 192);
+            _mm512_storeu_si512(dst + i,       a);
+            _mm512_storeu_si512(dst + i + 64,  b);
+            _mm512_storeu_si512(dst + i + 128, c);
+            _mm512_storeu_si512(dst + i + 192, d);
+        }
+        while (i >= 64) {
+            i -= 64;
+            _mm512_storeu_si512(dst + i, _mm512_loadu_si512(src + i));
+        }
+        _mm512_storeu_si512(dst, head);
+    }
+
+    CTL_TARGET("avx512f") static void copy_stream_avx512(Uint8* dst, const Uint8* src, Ulen len) {
+        using V = __m512i;
+        _mm512_storeu_si512(dst, _mm512_loadu_si512(src));
+        Ulen i = 64 - (reinterpret_cast<Address>(dst) & 63);
+        for (; i + 256 <= len; i += 256) {
+            const V a = _mm512_loadu_si512(src + i);
+            const V b = _mm512_loadu_si512(src + i + 64);
+            const V c = _mm512_loadu_si512(src + i + 128);
+            const V d = _mm512_loadu_si512(src + i + 192);
+            _mm512_stream_si512(reinterpret_cast<V*>(dst + i),       a);
+            _mm512_stream_si512(reinterpret_cast<V*>(dst + i + 64),  b);
+            _mm512_stream_si512(reinterpret_cast<V*>(dst + i + 128), c);
+            _mm512_stream_si512(reinterpret_cast<V*>(dst + i + 192), d);
+        }
+        _mm_sfence();
+        copy_avx512(dst + len - 256, src + len - 256, 256);
+    }
+
+    CTL_TARGET("avx512f") static void zero_avx512(Uint8* dst, Ulen len) {
+        const auto zero = _mm512_setzero_si512();
+        Ulen i = 0;
+        for (; i + 256 <= len; i += 256) {
+            _mm512_storeu_si512(dst + i,       zero);
+            _mm512_storeu_si512(dst + i + 64,  zero);
+            _mm512_storeu_si512(dst + i + 128, zero);
+            _mm512_storeu_si512(dst + i + 192, zero);
+        }
+        for (; i + 64 <= len; i += 64) {
+            _mm512_storeu_si512(dst + i, zero);
+        }
+        _mm512_storeu_si512(dst + len - 64, zero);
+    }
+
+    CTL_TARGET("avx512f") static void zero_stream_avx512(Uint8* dst, Ulen len) {
+        using V = __m512i;
+        const V zero = _mm512_setzero_si512();
+        _mm512_storeu_si512(dst, zero);
+        Ulen i = 64 - (reinterpret_cast<Address>(dst) & 63);
+        for (; i + 256 <= len; i += 256) {
+            _mm512_stream_si512(reinterpret_cast<V*>(dst + i),       zero);
+            _mm512_stream_si512(reinterpret_cast<V*>(dst + i + 64),  zero);
+            _mm512_stream_si512(reinterpret_cast<V*>(dst + i + 128), zero);
+            _mm512_stream_si512(reinterpret_cast<V*>(dst + i + 192), zero);
+        }
+        _mm_sfence();
+        zero_avx512(dst + len - 256, 256);
+    }
+
+    static constexpr const MemoryKernels SSE2_KERNELS = {
+        copy_sse2, copy_backward_sse2, copy_stream_sse2, zero_sse2, zero_stream_sse2,
+    };
+    static constexpr const MemoryKernels AVX2_KERNELS = {
+        copy_avx2, copy_backward_avx2, copy_stream_avx2, zero_avx2, zero_stream_avx2,
+    };
+    static constexpr const MemoryKernels AVX512_KERNELS = {
+        copy_avx512, copy_backward_avx512, copy_stream_avx512, zero_avx512, zero_stream_avx512,
+    };
+
+    static const MemoryKernels* select_memory_kernels() {
+        const auto cpuid = [](Uint32 leaf, Uint32 (&regs)[4]) {
+    #if defined(CTL_COMPILER_MSVC)
+            int r[4];
+            __cpuidex(r, int(leaf), 0);
+            for (int i = 0; i < 4; i++) regs[i] = Uint32(r[i]);
+    #else
+            __cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+    #endif
+        };
+        Uint32 regs[4];
+        cpuid(0, regs);
+        if (regs[0] < 7) {
+            return &SSE2_KERNELS;
+        }
+        cpuid(1, regs);
+        const Bool osxsave = (regs[2] >> 27) & 1;
+        if (!osxsave) {
+            return &SSE2_KERNELS;
+        }
+    #if defined(CTL_COMPILER_MSVC)
+        const auto xcr0 = Uint64(_xgetbv(0));
+    #else
+        Uint32 lo = 0, hi = 0;
+        __asm__ __volatile__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+        const auto xcr0 = (Uint64(hi) << 32) | lo;
+    #endif
+        cpuid(7, regs);
+        const Bool avx2    = (regs[1] >> 5) & 1;
+        const Bool avx512f = (regs[1] >> 16) & 1;
+        // XMM|YMM state, plus opmask|ZMM_Hi256|Hi16_ZMM state for AVX-512.
+        if (avx512f && (xcr0 & 0xe6) == 0xe6) {
+            return &AVX512_KERNELS;
+        }
+        if (avx2 && (xcr0 & 0x06) == 0x06) {
+            return &AVX2_KERNELS;
+        }
+        return &SSE2_KERNELS;
+    }
+
+    static constinit Atomic<const MemoryKernels*> g_memory_kernels;
+
+    static const MemoryKernels* memory_kernels() {
+        auto kernels = g_memory_kernels.load(MemoryOrder::RELAXED);
+        if (!kernels) {
+            // Every thread racing here selects the same table.
+            kernels = select_memory_kernels();
+            g_memory_kernels.store(kernels, MemoryOrder::RELAXED);
+        }
+        return kernels;
+    }
+#endif
+
     void Allocator::memzero(Address addr, Ulen len) {
         auto dst = reinterpret_cast<Uint8*>(addr);
 
@@ -67,6 +438,11 @@ namespace ctl {
         }
 
 #if defined(CTL_ARCH_X64)
+        if (len >= STREAM_THRESHOLD) {
+            return memory_kernels()->zero_stream(dst, len);
+        } else if (len >= DISPATCH_MIN) {
+            return memory_kernels()->zero(dst, len);
+        }
         const __m128i zero = _mm_setzero_si128();
         Ulen i = 0;
         for (; i + 64 <= len; i += 64) {
@@ -168,6 +544,11 @@ namespace ctl {
         }
 
 #if defined(CTL_ARCH_X64)
+        if (len >= STREAM_THRESHOLD) {
+            return memory_kernels()->copy_stream(dst, src, len);
+        } else if (len >= DISPATCH_MIN) {
+            return memory_kernels()->copy(dst, src, len);
+        }
         Ulen i = 0;
         for (; i + 64 <= len; i += 64) {
             const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
@@ -245,6 +626,90 @@ namespace ctl {
 #endif
     }
 
+    void Allocator::memmove(Address dst_addr, Address src_addr, Ulen len) {
+        if (dst_addr == src_addr) return;
+        if (len < 16 || dst_addr + len <= src_addr || src_addr + len <= dst_addr) {
+            // Disjoint ranges, or short enough that memcopy loads everything
+            // before its first store.
+            return memcopy(dst_addr, src_addr, len);
+        }
+        auto dst = reinterpret_cast<Uint8*>(dst_addr);
+        auto src = reinterpret_cast<const Uint8*>(src_addr);
+#if defined(CTL_ARCH_X64)
+        const auto kernels = len >= DISPATCH_MIN ? memory_kernels() : &SSE2_KERNELS;
+        if (dst < src) {
+            kernels->copy(dst, src, len);
+        } else {
+            kernels->copy_backward(dst, src, len);
+        }
+#elif defined(CTL_ARCH_WASM) && defined(__wasm_bulk_memory__)
+        __builtin_memmove(dst, src, len);
+#else
+        if (dst < src) {
+            for (Ulen i = 0; i < len; i++) dst[i] = src[i];
+        } else {
+            for (Ulen i = len; i > 0; i--) dst[i - 1] = src[i - 1];
+        }
+#endif
+    }
+
+    // Header in front of an over-aligned block from the default alloc_aligned.
+    // alloc() returns ALIGNMENT aligned blocks and align is at least twice that
+    // here, so rounding up from one past the block start always leaves at least
+    // ALIGNMENT bytes of room for it.
+    struct AlignedHeader {
+        Address addr;
+        Ulen    len;
+    };
+    static_assert(sizeof(AlignedHeader) <= Allocator::ALIGNMENT);
+
+    static AlignedHeader* aligned_header(Address addr) {
+        return reinterpret_cast<AlignedHeader*>(addr - sizeof(AlignedHeader));
+    }
+
+    static constexpr Address align_up(Address addr, Ulen align) {
+        return (addr + align - 1) & ~Address(align - 1);
+    }
+
+    Address Allocator::alloc_aligned(Ulen new_len, Ulen align, Bool zero) {
+        if (align <= ALIGNMENT) {
+            return alloc(new_len, zero);
+        }
+        const auto raw_len = new_len + align;
+        const auto raw_addr = alloc(raw_len, zero);
+        if (!raw_addr) {
+            return 0;
+        }
+        const auto addr = align_up(raw_addr + 1, align);
+        *aligned_header(addr) = { raw_addr, raw_len };
+        return addr;
+    }
+
+    void Allocator::free_aligned(Address addr, Ulen old_len, Ulen align) {
+        if (align <= ALIGNMENT) {
+            return free(addr, old_len);
+        }
+        if (addr == 0) return;
+        const auto header = *aligned_header(addr);
+        free(header.addr, header.len);
+    }
+
+    Address Allocator::grow_aligned(Address old_addr, Ulen old_len, Ulen new_len, Ulen align, Bool zero) {
+        if (align <= ALIGNMENT) {
+            return grow(old_addr, old_len, new_len, zero);
+        }
+        const auto new_addr = alloc_aligned(new_len, align, false);
+        if (!new_addr) {
+            return 0;
+        }
+        memcopy(new_addr, old_addr, old_len);
+        if (zero) {
+            memzero(new_addr + old_len, new_len - old_len);
+        }
+        free_aligned(old_addr, old_len, align);
+        return new_addr;
+    }
+
     ArenaAllocator::ArenaAllocator(Address base, Ulen length)
         : region_{base, base + length}
         , cursor_{base}
@@ -339,6 +804,167 @@ namespace ctl {
         return dst_addr;
     }
 
+    Address ArenaAllocator::alloc_aligned(Ulen req_len, Ulen align, Bool zero) {
+        const auto pad = align_up(cursor_, align) - cursor_;
+        if (pad > region_.end - cursor_) {
+            return 0;
+        }
+        // The padding is lost, freeing the block only rewinds to its start.
+        cursor_ += pad;
+        if (const auto addr = alloc(req_len, zero)) {
+            return addr;
+        }
+        cursor_ -= pad;
+        return 0;
+    }
+
+    void ArenaAllocator::free_aligned(Address addr, Ulen req_old_len, Ulen) {
+        free(addr, req_old_len);
+    }
+
+    Address ArenaAllocator::grow_aligned(Address src_addr, Ulen req_old_len, Ulen req_new_len, Ulen align, Bool zero) {
+        if (src_addr + round(req_old_len) == cursor_) {
+            // In place, the address does not change.
+            return grow(src_addr, req_old_len, req_new_len, zero);
+        }
+        return Allocator::grow_aligned(src_addr, req_old_len, req_new_len, align, zero);
+    }
+
+    Maybe<VirtualArena> VirtualArena::create(Ulen reserve) {
+        reserve = ((reserve + COMMIT_SIZE - 1) / COMMIT_SIZE) * COMMIT_SIZE;
+        const auto base = Heap::reserve(reserve);
+        if (!base) {
+            return {};
+        }
+        return VirtualArena{reinterpret_cast<Address>(base), reserve};
+    }
+
+    VirtualArena::~VirtualArena() {
+        if (region_.beg) {
+            Heap::release(reinterpret_cast<void*>(region_.beg), reserved());
+        }
+    }
+
+    Bool VirtualArena::owns(Address addr, Ulen len) const {
+        return addr >= region_.beg && (addr + len <= region_.end);
+    }
+
+    void VirtualArena::reset() {
+        if (commit_ != region_.beg) {
+            Heap::decommit(reinterpret_cast<void*>(region_.beg), committed());
+        }
+        cursor_ = region_.beg;
+        commit_ = region_.beg;
+        dirty_  = region_.beg;
+    }
+
+    Bool VirtualArena::commit(Address end) {
+        if (end <= commit_) {
+            return true;
+        }
+        const auto offset = ((end - region_.beg + COMMIT_SIZE - 1) / COMMIT_SIZE) * COMMIT_SIZE;
+        const auto new_commit = region_.beg + offset;
+        if (new_commit > region_.end) {
+            return false;
+        }
+        if (!Heap::commit(reinterpret_cast<void*>(commit_), new_commit - commit_)) {
+            return false;
+        }
+        commit_ = new_commit;
+        return true;
+    }
+
+    Address VirtualArena::alloc(Ulen req_len, Bool zero) {
+        const Ulen new_len = round(req_len);
+        if (new_len > region_.end - cursor_ || !commit(cursor_ + new_len)) {
+            return 0;
+        }
+        const auto addr = cursor_;
+        cursor_ += new_len;
+        // Pages past dirty_ were never handed out since they got committed and
+        // are still zero.
+        if (zero && addr < dirty_) {
+            memzero(addr, dirty_ - addr < req_len ? dirty_ - addr : req_len);
+        }
+        if (cursor_ > dirty_) {
+            dirty_ = cursor_;
+        }
+        return addr;
+    }
+
+    void VirtualArena::free(Address addr, Ulen req_old_len) {
+        if (addr == 0) return;
+        const Ulen old_len = round(req_old_len);
+        if (addr + old_len == cursor_) {
+            cursor_ -= old_len;
+        }
+    }
+
+    void VirtualArena::shrink(Address addr, Ulen req_old_len, Ulen req_new_len) {
+        const Ulen old_len = round(req_old_len);
+        const Ulen new_len = round(req_new_len);
+        if (addr + old_len == cursor_) {
+            cursor_ -= old_len;
+            cursor_ += new_len;
+        }
+    }
+
+    Address VirtualArena::grow(Address src_addr, Ulen req_old_len, Ulen req_new_len, Bool zero) {
+        const Ulen old_len = round(req_old_len);
+        const Ulen new_len = round(req_new_len);
+        if (src_addr + old_len == cursor_) {
+            const auto delta = new_len - old_len;
+            if (delta > region_.end - cursor_ || !commit(cursor_ + delta)) {
+                // Reservation exhausted.
+                return 0;
+            }
+            const auto tail = src_addr + req_old_len;
+            if (zero && tail < dirty_) {
+                const auto req_delta = req_new_len - req_old_len;
+                memzero(tail, dirty_ - tail < req_delta ? dirty_ - tail : req_delta);
+            }
+            cursor_ += delta;
+            if (cursor_ > dirty_) {
+                dirty_ = cursor_;
+            }
+            return src_addr;
+        }
+        const auto dst_addr = alloc(req_new_len, false);
+        if (!dst_addr) {
+            return 0;
+        }
+        memcopy(dst_addr, src_addr, req_old_len);
+        if (zero) {
+            memzero(dst_addr + req_old_len, req_new_len - req_old_len);
+        }
+        free(src_addr, req_old_len);
+        return dst_addr;
+    }
+
+    Address VirtualArena::alloc_aligned(Ulen req_len, Ulen align, Bool zero) {
+        const auto pad = align_up(cursor_, align) - cursor_;
+        if (pad > region_.end - cursor_) {
+            return 0;
+        }
+        cursor_ += pad;
+        if (const auto addr = alloc(req_len, zero)) {
+            return addr;
+        }
+        cursor_ -= pad;
+        return 0;
+    }
+
+    void VirtualArena::free_aligned(Address addr, Ulen req_old_len, Ulen) {
+        free(addr, req_old_len);
+    }
+
+    Address VirtualArena::grow_aligned(Address src_addr, Ulen req_old_len, Ulen req_new_len, Ulen align, Bool zero) {
+        if (src_addr + round(req_old_len) == cursor_) {
+            return grow(src_addr, req_old_len, req_new_len, zero);
+        }
+        return Allocator::grow_aligned(src_addr, req_old_len, req_new_len, align, zero);
+    }
+
     TemporaryAllocator::~TemporaryAllocator() {
         for (auto node = head_; node; /**/) {
             const auto addr = reinterpret_cast<Address>(node);
@@ -346,20 +972,99 @@ namespace ctl {
             allocator_.free(addr, sizeof(Block) + node->arena_.length());
             node = next;
         }
+        allocator_.deallocate(slots_, capacity_);
+    }
+
+    static inline Ulen hash_chunk(Address chunk) {
+        const auto h = Uint64(chunk) * 0x9e3779b97f4a7c15_u64;
+        return Ulen(h ^ (h >> 32));
+    }
+
+    TemporaryAllocator::Block* TemporaryAllocator::find(Address addr) const {
+        if (!slots_) {
+            return nullptr;
+        }
+        const auto chunk = (addr >> CHUNK_SHIFT) + 1;
+        const auto mask = capacity_ - 1;
+        for (auto i = hash_chunk(chunk) & mask; slots_[i].chunk; i = (i + 1) & mask) {
+            if (slots_[i].chunk != chunk) {
+                continue;
+            }
+            for (const auto block : slots_[i].blocks) {
+                if (block && block->contains(addr)) {
+                    return block;
+                }
+            }
+            return nullptr;
+        }
+        return nullptr;
+    }
+
+    void TemporaryAllocator::insert(Address chunk, Block* block) {
+        const auto mask = capacity_ - 1;
+        auto i = hash_chunk(chunk) & mask;
+        for (; slots_[i].chunk; i = (i + 1) & mask) {
+            if (slots_[i].chunk == chunk) {
+                slots_[i].blocks[slots_[i].blocks[0] ? 1 : 0] = block;
+                return;
+            }
+        }
+        slots_[i] = { chunk, { block, nullptr } };
+        used_++;
+    }
+
+    Bool TemporaryAllocator::index(Block* block) {
+        const auto beg = reinterpret_cast<Address>(block->data_);
+        const auto first = (beg >> CHUNK_SHIFT) + 1;
+        const auto last = ((beg + block->arena_.length() - 1) >> CHUNK_SHIFT) + 1;
+        const auto n_chunks = Ulen(last - first + 1);
+        // Keep the table at most half full.
+        if ((used_ + n_chunks) * 2 > capacity_) {
+            Ulen capacity = capacity_ ? capacity_ : 16;
+            while ((used_ + n_chunks) * 2 > capacity) {
+                capacity *= 2;
+            }
+            const auto slots = allocator_.allocate<Slot>(capacity, true);
+            if (!slots) {
+                return false;
+            }
+            const auto old_slots = exchange(slots_, slots);
+            const auto old_capacity = exchange(capacity_, capacity);
+            used_ = 0;
+            for (Ulen i = 0; i < old_capacity; i++) {
+                const auto& slot = old_slots[i];
+                for (const auto other : slot.blocks) {
+                    if (other) {
+                        insert(slot.chunk, other);
+                    }
+                }
+            }
+            allocator_.deallocate(old_slots, old_capacity);
+        }
+        for (auto chunk = first; chunk <= last; chunk++) {
+            insert(chunk, block);
+        }
+        return true;
     }
 
     Bool TemporaryAllocator::add(Ulen len) {
-        // 2 MiB chunks and double in size until large enough for 'len'
-        Ulen block_size = 2 << 20;
-        while (block_size < len) {
-            block_size *= 2;
+        // 2 MiB chunks and double in size until large enough for 'len'. The
+        // header is included so the parent sees exact (huge) page multiples.
+        Ulen chunk_size = 2 << 20;
+        while (chunk_size - sizeof(Block) < len) {
+            chunk_size *= 2;
         }
+        const auto block_size = chunk_size - sizeof(Block);
         const auto addr = allocator_.alloc(sizeof(Block) + block_size, false);
         if (!addr) {
             return false;
         }
         const auto ptr = reinterpret_cast<void*>(addr);
         const auto node = new (ptr, Nat{}) Block{block_size};
+        if (!index(node)) {
+            allocator_.free(addr, sizeof(Block) + block_size);
+            return false;
+        }
         if (tail_) {
             tail_->next_ = node;
             node->prev_ = tail_;
@@ -400,30 +1105,21 @@ namespace ctl {
 
     void TemporaryAllocator::free(Address addr, Ulen old_len) {
         if (addr == 0) return;
-        for (auto node = tail_; node; node = node->prev_) {
-            if (node->arena_.owns(addr, old_len)) {
-                node->arena_.free(addr, old_len);
-                return;
-            }
+        if (const auto block = find(addr)) {
+            block->arena_.free(addr, old_len);
         }
     }
 
     void TemporaryAllocator::shrink(Address addr, Ulen old_len, Ulen new_len) {
-        for (auto node = head_; node; node = node->next_) {
-            if (node->arena_.owns(addr, old_len)) {
-                node->arena_.shrink(addr, old_len, new_len);
-                return;
-            }
+        if (const auto block = find(addr)) {
+            block->arena_.shrink(addr, old_len, new_len);
         }
     }
 
     Address TemporaryAllocator::grow(Address old_addr, Ulen old_len, Ulen new_len, Bool zero) {
         // Attempt in-place growth.
-        for (auto node = head_; node; node = node->next_) {
-            if (!node->arena_.owns(old_addr, old_len)) {
-                continue;
-            }
-            if (auto new_addr = node->arena_.grow(old_addr, old_len, new_len, zero)) {
+        if (const auto block = find(old_addr)) {
+            if (auto new_addr = block->arena_.grow(old_addr, old_len, new_len, zero)) {
                 return new_addr;
             }
         }
@@ -442,8 +1138,353 @@ namespace ctl {
         return new_addr;
     }
 
+    Address TemporaryAllocator::alloc_aligned(Ulen new_len, Ulen align, Bool zero) {
+        if (align <= ALIGNMENT) {
+            return alloc(new_len, zero);
+        }
+        new_len = round(new_len);
+        // A fresh block may need up to `align` bytes of padding in front.
+        if (!tail_ && !add(new_len + align)) {
+            return 0;
+        }
+        if (const auto addr = tail_->arena_.alloc_aligned(new_len, align, zero)) {
+            return addr;
+        }
+        if (tail_->next_) {
+            tail_ = tail_->next_;
+            return alloc_aligned(new_len, align, zero);
+        }
+        if (!add(new_len + align)) {
+            return 0;
+        }
+        return alloc_aligned(new_len, align, zero);
+    }
+
+    void TemporaryAllocator::free_aligned(Address addr, Ulen old_len, Ulen) {
+        free(addr, old_len);
+    }
+
+    Address TemporaryAllocator::grow_aligned(Address old_addr, Ulen old_len, Ulen new_len, Ulen align, Bool zero) {
+        if (const auto block = find(old_addr)) {
+            if (auto new_addr = block->arena_.grow_aligned(old_addr, old_len, new_len, align, zero)) {
+                return new_addr;
+            }
+        }
+        return Allocator::grow_aligned(old_addr, old_len, new_len, align, zero);
+    }
+
+    // Size-class heap backing SystemAllocator.
+    //
+    // Requests up to SMALL_MAX bytes are rounded up to one of N_CLASSES size
+    // classes: 16 byte steps up to 128 bytes, then four classes per power of two
+    // up to 32 KiB, so at most 25% of a block is wasted. Each class bumps blocks
+    // out of SPAN_SIZE regions obtained from Heap and recycles freed blocks
+    // through an intrusive free list. Since free() is always told the length of
+    // the block, the class is recomputed from it and no per-block header is
+    // needed. Larger requests go straight to Heap.
+    //
+    // The state is global because SystemAllocator itself is stateless: memory
+    // allocated through one instance may be freed through another. Spans are
+    // never returned to the OS, freed blocks only go back to their class.
+    // Blocks from Heap::allocate_huge start on a huge page. No size class block
+    // does, so a huge block is recognized by its address whatever its length.
+    static constexpr Bool huge_aligned(Address addr) {
+        return (addr & (Heap::HUGE_PAGE_SIZE - 1)) == 0;
+    }
+
+    struct SizeClassHeap {
+        static constexpr const Ulen   SMALL_MAX = 32 << 10;
+        static constexpr const Ulen   SPAN_SIZE = 1 << 20;
+        static constexpr const Uint32 N_CLASSES = 40;
+
+        static constexpr Uint32 class_of(Ulen len) {
+            if (len <= 128) {
+                return len ? Uint32((len + 15) / 16 - 1) : 0;
+            }
+            // For len in (2^lg, 2^(lg+1)] classes are spaced 2^(lg-2) apart.
+            Uint32 lg = 0;
+            for (auto v = len - 1; v > 1; v >>= 1) lg++;
+            const auto step = Uint32((len - 1) >> (lg - 2)); // In [4, 7]
+            return 8 + (lg - 7) * 4 + (step - 4);
+        }
+
+        static constexpr Ulen size_of(Uint32 index) {
+            if (index < 8) {
+                return (index + 1) * 16;
+            }
+            const auto lg   = 7 + (index - 8) / 4;
+            const auto step = 4 + (index - 8) % 4;
+            return Ulen(step + 1) << (lg - 2);
+        }
+
+        // Free blocks are threaded through their first word. The link is kept
+        // inaccessible to ASAN and Valgrind while the block is free.
+        struct Node {
+            static Node* next(Node* node) {
+                ASAN_UNPOISON_MEMORY_REGION(node, sizeof(Node));
+                VALGRIND_MAKE_MEM_DEFINED(node, sizeof(Node));
+                const auto next = node->next_;
+                ASAN_POISON_MEMORY_REGION(node, sizeof(Node));
+                VALGRIND_MAKE_MEM_NOACCESS(node, sizeof(Node));
+                return next;
+            }
+            static void link(Node* node, Node* next) {
+                ASAN_UNPOISON_MEMORY_REGION(node, sizeof(Node));
+                VALGRIND_MAKE_MEM_UNDEFINED(node, sizeof(Node));
+                node->next_ = next;
+                ASAN_POISON_MEMORY_REGION(node, sizeof(Node));
+                VALGRIND_MAKE_MEM_NOACCESS(node, sizeof(Node));
+            }
+        private:
+            Node* next_;
+        };
+
+        Address alloc(Uint32 index, Ulen len, Bool zero) {
+            auto& sc = classes_[index];
+            const auto size = size_of(index);
+            sc.lock.lock();
+            if (auto node = sc.free) {
+                sc.free = Node::next(node);
+                sc.lock.unlock();
+                ASAN_UNPOISON_MEMORY_REGION(node, sizeof(Node));
+                const auto addr = reinterpret_cast<Address>(node);
+                if (zero) {
+                    Allocator::memzero(addr, len);
+                }
+                return addr;
+            }
+            if (sc.cursor + size > sc.end && !refill(sc)) {
+                sc.lock.unlock();
+                return 0;
+            }
+            // Never handed out before, still zeroed from Heap::allocate.
+            const auto addr = sc.cursor;
+            sc.cursor += size;
+            sc.lock.unlock();
+            return addr;
+        }
+
+        void free(Uint32 index, Address addr) {
+            auto& sc = classes_[index];
+            const auto node = reinterpret_cast<Node*>(addr);
+            sc.lock.lock();
+            Node::link(node, sc.free);
+            sc.free = node;
+            sc.lock.unlock();
+        }
+
+        // Takes up to `count` blocks with a single lock round trip, linked into
+        // `head`. Returns how many were obtained.
+        Uint32 alloc_batch(Uint32 index, Node*& head, Uint32 count) {
+            auto& sc = classes_[index];
+            const auto size = size_of(index);
+            Uint32 n = 0;
+            sc.lock.lock();
+            while (n < count && sc.free) {
+                const auto node = sc.free;
+                sc.free = Node::next(node);
+                Node::link(node, head);
+                head = node;
+                n++;
+            }
+            while (n < count) {
+                if (sc.cursor + size > sc.end && !refill(sc)) {
+                    break;
+                }
+                const auto node = reinterpret_cast<Node*>(sc.cursor);
+                sc.cursor += size;
+                Node::link(node, head);
+                head = node;
+                n++;
+            }
+            sc.lock.unlock();
+            return n;
+        }
+
+        // Returns the already linked list [head, tail] with a single lock round trip.
+        void free_batch(Uint32 index, Node* head, Node* tail) {
+            auto& sc = classes_[index];
+            sc.lock.lock();
+            Node::link(tail, sc.free);
+            sc.free = head;
+            sc.lock.unlock();
+        }
+
+    private:
+        struct Class {
+            SpinLock lock;
+            Node*    free   = nullptr;
+            Address  cursor = 0;
+            Address  end    = 0;
+        };
+
+        // Called with the class lock held. The tail of the previous span (smaller
+        // than one block) is abandoned.
+        static Bool refill(Class& sc) {
+            const auto span = Heap::allocate(SPAN_SIZE, true);
+            if (!span) {
+                return false;
+            }
+            sc.cursor = reinterpret_cast<Address>(span);
+            if (huge_aligned(sc.cursor)) {
+                // Keep HUGE_PAGE_SIZE aligned addresses for huge blocks, see
+                // SystemAllocator::free.
+                sc.cursor += Allocator::ALIGNMENT;
+            }
+            sc.end = sc.cursor + SPAN_SIZE;
+            return true;
+        }
+
+        Class classes_[N_CLASSES];
+    };
+
+    static_assert(SizeClassHeap::class_of(SizeClassHeap::SMALL_MAX) == SizeClassHeap::N_CLASSES - 1);
+    static_assert(SizeClassHeap::size_of(SizeClassHeap::N_CLASSES - 1) == SizeClassHeap::SMALL_MAX);
+    static_assert(SizeClassHeap::size_of(SizeClassHeap::class_of(129)) == 160);
+
+#if !defined(CTL_CFG_USE_MALLOC)
+    static constinit SizeClassHeap g_size_class_heap;
+
+    // WASM is single threaded, a thread cache would only add a second layer of
+    // free lists there.
+    #if !defined(CTL_HOST_PLATFORM_WASM)
+        #define CTL_THREAD_CACHE 1
+    #endif
+#endif
+
+#if defined(CTL_THREAD_CACHE)
+    // Per-thread front end of the size-class heap.
+    //
+    // Each thread keeps a LIFO bin of free blocks per size class, so the common
+    // alloc/free is a pointer pop/push with no lock and no atomic. An empty bin
+    // is refilled with a batch of blocks from the global heap and a full bin
+    // drains half of itself back, each in one lock round trip. A bin holds at
+    // most limit() blocks and the whole cache about MAX_BYTES, after which frees
+    // are pushed back to the global heap. The cache is flushed when its thread
+    // exits, any allocation made after that bypasses it.
+    struct ThreadCache {
+        using Node = SizeClassHeap::Node;
+
+        static constexpr const Ulen MAX_BYTES = 1 << 20;
+
+        static constexpr Uint32 limit(Uint32 index) {
+            const auto n = (32 << 10) / SizeClassHeap::size_of(index);
+            return n < 4 ? 4 : (n > 256 ? 256 : Uint32(n));
+        }
+
+        constexpr ThreadCache() = default;
+        ThreadCache(const ThreadCache&) = delete;
+        ~ThreadCache() {
+            for (Uint32 index = 0; index < SizeClassHeap::N_CLASSES; index++) {
+                drain(index, bins_[index].count);
+            }
+            dead_ = true;
+        }
+
+        Address alloc(Uint32 index, Ulen len, Bool zero) {
+            if (dead_) {
+                return g_size_class_heap.alloc(index, len, zero);
+            }
+            auto& bin = bins_[index];
+            if (!bin.head) {
+                const auto n = g_size_class_heap.alloc_batch(index, bin.head, limit(index) / 2);
+                if (n == 0) {
+                    return 0;
+                }
+                bin.count += n;
+                bytes_ += n * SizeClassHeap::size_of(index);
+            }
+            const auto node = bin.head;
+            bin.head = Node::next(node);
+            bin.count--;
+            bytes_ -= SizeClassHeap::size_of(index);
+            ASAN_UNPOISON_MEMORY_REGION(node, sizeof(Node));
+            const auto addr = reinterpret_cast<Address>(node);
+            if (zero) {
+                Allocator::memzero(addr, len);
+            }
+            return addr;
+        }
+
+        void free(Uint32 index, Address addr) {
+            if (dead_) {
+                return g_size_class_heap.free(index, addr);
+            }
+            auto& bin = bins_[index];
+            const auto node = reinterpret_cast<Node*>(addr);
+            Node::link(node, bin.head);
+            bin.head = node;
+            bin.count++;
+            bytes_ += SizeClassHeap::size_of(index);
+            if (bin.count > limit(index) || bytes_ > MAX_BYTES) {
+                drain(index, (bin.count + 1) / 2);
+            }
+        }
+
+    private:
+        // Hands the `count` most recently freed blocks of a bin back to the heap.
+        void drain(Uint32 index, Uint32 count) {
+            auto& bin = bins_[index];
+            if (count == 0) {
+                return;
+            }
+            const auto head = bin.head;
+            auto tail = head;
+            for (Uint32 i = 1; i < count; i++) {
+                tail = Node::next(tail);
+            }
+            bin.head = Node::next(tail);
+            bin.count -= count;
+            bytes_ -= count * SizeClassHeap::size_of(index);
+            g_size_class_heap.free_batch(index, head, tail);
+        }
+
+        struct Bin {
+            Node*  head  = nullptr;
+            Uint32 count = 0;
+        };
+        Bin  bins_[SizeClassHeap::N_CLASSES];
+        Ulen bytes_ = 0;
+        Bool dead_  = false;
+    };
+
+    static thread_local constinit ThreadCache t_thread_cache;
+#endif
+
+#if !defined(CTL_CFG_USE_MALLOC)
+    static Address small_alloc(Uint32 index, Ulen len, Bool zero) {
+    #if defined(CTL_THREAD_CACHE)
+        return t_thread_cache.alloc(index, len, zero);
+    #else
+        return g_size_class_heap.alloc(index, len, zero);
+    #endif
+    }
+
+    static void small_free(Uint32 index, Address addr) {
+    #if defined(CTL_THREAD_CACHE)
+        t_thread_cache.free(index, addr);
+    #else
+        g_size_class_heap.free(index, addr);
+    #endif
+    }
+#endif
+
     Address SystemAllocator::alloc(Ulen new_len, Bool zero) {
-        if (const auto ptr = Heap::allocate(new_len, zero)) {
+        // Zero length blocks are never handed out (mapping zero pages fails
+        // too), so free() can drop zero length frees.
+        if (new_len == 0) return 0;
+#if !defined(CTL_CFG_USE_MALLOC)
+        if (new_len <= SizeClassHeap::SMALL_MAX) {
+            const auto addr = small_alloc(SizeClassHeap::class_of(new_len), new_len, zero);
+            if (addr) {
+                VALGRIND_MALLOCLIKE_BLOCK(addr, new_len, 0, zero);
+            }
+            return addr;
+        }
+#endif
+        const auto ptr = huge_pages_ ? Heap::allocate_huge(new_len, zero)
+                                     : Heap::allocate(new_len, zero);
+        if (ptr) {
             ASAN_UNPOISON_MEMORY_REGION(ptr, new_len);
             VALGRIND_MALLOCLIKE_BLOCK(ptr, new_len, 0, zero);
             return reinterpret_cast<Address>(ptr);
@@ -452,30 +1493,130 @@ namespace ctl {
     }
 
     void SystemAllocator::free(Address addr, Ulen old_len) {
-        if (addr == 0) return;
+        // A zero length is not a block from alloc(). Class 0 would take it as a
+        // 16 byte block and hand the same memory out twice.
+        if (addr == 0 || old_len == 0) return;
+#if !defined(CTL_CFG_USE_MALLOC)
+        // A huge block shrunk below SMALL_MAX still owns its huge page.
+        if (old_len <= SizeClassHeap::SMALL_MAX && !(huge_pages_ && huge_aligned(addr))) {
+            VALGRIND_FREELIKE_BLOCK(addr, 0);
+            small_free(SizeClassHeap::class_of(old_len), addr);
+            return;
+        }
+#endif
         const auto ptr = reinterpret_cast<void *>(addr);
-        Heap::deallocate(ptr, old_len);
+        if (huge_pages_) {
+            Heap::deallocate_huge(ptr, old_len);
+        } else {
+            Heap::deallocate(ptr, old_len);
+        }
         ASAN_POISON_MEMORY_REGION(ptr, old_len);
         VALGRIND_FREELIKE_BLOCK(ptr, 0);
     }
 
-    void SystemAllocator::shrink(Address, Ulen, Ulen) {
-        // no-op
+    void SystemAllocator::shrink(Address addr, Ulen old_len, Ulen new_len) {
+#if !defined(CTL_CFG_USE_MALLOC)
+        if (old_len <= SizeClassHeap::SMALL_MAX) {
+            // The block keeps its size class. Freeing it later with the smaller
+            // length files it under a smaller class, which is safe since it is larger.
+            return;
+        }
+        if (new_len <= SizeClassHeap::SMALL_MAX && !huge_pages_) {
+            // It will be freed into a size class, keep enough pages for that class.
+            // A huge block keeps its first huge page instead and free() tells it
+            // apart by its address.
+            new_len = SizeClassHeap::size_of(SizeClassHeap::class_of(new_len));
+        }
+#endif
+        // Releases the tail pages, the address never changes.
+        const auto ptr = reinterpret_cast<void*>(addr);
+        if (huge_pages_) {
+            Heap::resize_huge(ptr, old_len, new_len, false);
+        } else {
+            Heap::resize(ptr, old_len, new_len, false);
+        }
+        VALGRIND_RESIZEINPLACE_BLOCK(addr, old_len, new_len, 0);
     }
 
     Address SystemAllocator::grow(Address old_addr, Ulen old_len, Ulen new_len, Bool zero) {
-        const auto new_ptr = Heap::allocate(new_len, false);
-        if (!new_ptr) {
+        if (old_len == 0) {
+            // Nothing to keep, and no block to extend.
+            return alloc(new_len, zero);
+        }
+#if !defined(CTL_CFG_USE_MALLOC)
+        if (new_len <= SizeClassHeap::SMALL_MAX &&
+            SizeClassHeap::class_of(old_len) == SizeClassHeap::class_of(new_len))
+        {
+            // Still fits in the block of the same size class.
+            if (zero) {
+                memzero(old_addr + old_len, new_len - old_len);
+            }
+            return old_addr;
+        }
+        const Bool mapped = old_len > SizeClassHeap::SMALL_MAX || (huge_pages_ && huge_aligned(old_addr));
+#else
+        const Bool mapped = true;
+#endif
+        if (mapped) {
+            // Page sized block, remap instead of copying.
+            const auto old_ptr = reinterpret_cast<void*>(old_addr);
+            const auto new_ptr = huge_pages_ ? Heap::resize_huge(old_ptr, old_len, new_len, zero)
+                                             : Heap::resize(old_ptr, old_len, new_len, zero);
+            if (new_ptr) {
+                const auto new_addr = reinterpret_cast<Address>(new_ptr);
+                if (new_addr == old_addr) {
+                    VALGRIND_RESIZEINPLACE_BLOCK(old_addr, old_len, new_len, 0);
+                } else {
+                    VALGRIND_FREELIKE_BLOCK(old_addr, 0);
+                    VALGRIND_MALLOCLIKE_BLOCK(new_addr, new_len, 0, zero);
+                }
+                return new_addr;
+            }
+        }
+        const auto new_addr = alloc(new_len, false);
+        if (!new_addr) {
             return 0;
         }
-        const auto new_addr = reinterpret_cast<Address>(new_ptr);
         memcopy(new_addr, old_addr, old_len);
         if (zero) {
             memzero(new_addr + old_len, new_len - old_len);
         }
-        const auto old_ptr = reinterpret_cast<void *>(old_addr);
-        Heap::deallocate(old_ptr, old_len);
+        free(old_addr, old_len);
         return new_addr;
     }
 
+
+    // Whether a block is served by plain alloc() at this alignment: large blocks
+    // are mapped pages and so aligned up to the page size.
+    static Bool page_aligned(Ulen len, Ulen align) {
+#if !defined(CTL_CFG_USE_MALLOC)
+        if (len > SizeClassHeap::SMALL_MAX && align <= Heap::page_size()) {
+            return true;
+        }
+#endif
+        return align <= Allocator::ALIGNMENT;
+    }
+
+    Address SystemAllocator::alloc_aligned(Ulen new_len, Ulen align, Bool zero) {
+        if (page_aligned(new_len, align)) {
+            return alloc(new_len, zero);
+        }
+        return Allocator::alloc_aligned(new_len, align, zero);
+    }
+
+    void SystemAllocator::free_aligned(Address addr, Ulen old_len, Ulen align) {
+        if (page_aligned(old_len, align)) {
+            return free(addr, old_len);
+        }
+        Allocator::free_aligned(addr, old_len, align);
+    }
+
+    Address SystemAllocator::grow_aligned(Address old_addr, Ulen old_len, Ulen new_len, Ulen align, Bool zero) {
+        if (page_aligned(old_len, align)) {
+            // Stays page aligned when remapped.
+            return grow(old_addr, old_len, new_len, zero);
+        }
+        return Allocator::grow_aligned(old_addr, old_len, new_len, align, zero);
+    }
+
 } // namespace ctl
@@ -45,6 +45,15 @@ extern "C" {
 	// No-op
     }
 
+#if defined(CTL_HOST_PLATFORM_LINUX)
+    // Registers destructors of thread_local objects (the SystemAllocator thread
+    // cache). libc provides the actual implementation, libstdc++ only forwards.
+    int __cxa_thread_atexit_impl(void (*dtor)(void*), void* obj, void* dso);
+    int __cxa_thread_atexit(void (*dtor)(void*), void* obj, void* dso) {
+	return __cxa_thread_atexit_impl(dtor, obj, dso);
+    }
+#endif
+
 } // extern "C"
 
 #endif
@@ -3,6 +3,7 @@
 #include "types.hpp"
 #include "forward.hpp"
 #include "exchange.hpp"
+#include "maybe.hpp"
 
 /// @namespace ctl
 /// @brief CTL is a lightweight C++ library providing essential STL-like features without relying on the standard library.
@@ -17,11 +18,18 @@ namespace ctl {
 	static void memzero(Address addr, Ulen len);
 
         /// @brief Copies memory from source to destination.
+        /// @note The ranges must not overlap, use `memmove` for that.
 	static void memcopy(Address dst, Address src, Ulen len);
 
+        /// @brief Copies memory from source to destination, the ranges may overlap.
+	static void memmove(Address dst, Address src, Ulen len);
+
+        /// @brief Alignment of every block returned by `alloc` and `grow`.
+	static inline constexpr const Ulen ALIGNMENT = 16;
+
         /// @brief Rounds up a length to the nearest multiple of 16 bytes.
 	static constexpr Ulen round(Ulen len) {
-            return ((len + 16 - 1) / 16) * 16;
+            return ((len + ALIGNMENT - 1) / ALIGNMENT) * ALIGNMENT;
 	}
 
         /// @brief Allocates a raw block of memory.
@@ -49,19 +57,44 @@ namespace ctl {
         /// @return The new address of the block (may be different from `addr`), or 0 on failure.
 	virtual Address grow(Address addr, Ulen old_len, Ulen new_len, Bool zero) = 0;
 
+	// --- Over-aligned allocation ---
+	//
+	// Blocks with an `align` above ALIGNMENT must be released and grown through
+	// the `_aligned` functions with the same `align`, never through `free`,
+	// `grow` or `shrink`. Up to ALIGNMENT these simply forward to `alloc`,
+	// `free` and `grow`. The default implementation over-allocates by `align`
+	// and keeps the underlying block in a header in front of the aligned address.
+
+        /// @brief Allocates a block whose address is a multiple of `align`.
+        /// @param length The size in bytes to allocate.
+        /// @param align The alignment, must be a power of two.
+        /// @param zero If true, the memory is initialized to zero.
+        /// @return The address of the allocated block, or 0 if allocation failed.
+	virtual Address alloc_aligned(Ulen length, Ulen align, Bool zero);
+
+        /// @brief Frees a block obtained from `alloc_aligned` or `grow_aligned`.
+	virtual void free_aligned(Address addr, Ulen old_len, Ulen align);
+
+        /// @brief Grows a block obtained from `alloc_aligned`, keeping its alignment.
+        /// @return The new address of the block, or 0 on failure.
+	virtual Address grow_aligned(Address addr, Ulen old_len, Ulen new_len, Ulen align, Bool zero);
+
 	// --- Helper functions when working with typed data ---
 
-        /// @brief Allocates memory for an array of T.
+        /// @brief Allocates memory for an array of T, aligned to `alignof(T)`.
         /// @tparam T The type of elements.
         /// @param count The number of elements.
         /// @param zero If true, memory is zeroed.
         /// @return A pointer to the allocated memory, or nullptr on failure.
 	template<typename T>
 	T* allocate(Ulen count, Bool zero) {
-            if (auto addr = alloc(count * sizeof(T), zero)) {
-                return reinterpret_cast<T*>(addr);
+            Address addr = 0;
+            if constexpr (alignof(T) > ALIGNMENT) {
+                addr = alloc_aligned(count * sizeof(T), alignof(T), zero);
+            } else {
+                addr = alloc(count * sizeof(T), zero);
             }
-            return nullptr;
+            return reinterpret_cast<T*>(addr);
 	}
 
         /// @brief Deallocates memory for an array of T.
@@ -69,7 +102,29 @@ namespace ctl {
 	template<typename T>
 	void deallocate(T* ptr, Ulen count) {
             auto addr = reinterpret_cast<Address>(ptr);
-            free(addr, count * sizeof(T));
+            if constexpr (alignof(T) > ALIGNMENT) {
+                free_aligned(addr, count * sizeof(T), alignof(T));
+            } else {
+                free(addr, count * sizeof(T));
+            }
+	}
+
+        /// @brief Grows an array of T from `old_count` to `new_count` elements through `grow`.
+        ///
+        /// Extends the block in place where the allocator can, otherwise the bytes
+        /// are copied to a new block, so T must be trivially relocatable.
+        /// @return A pointer to the grown array, or nullptr on failure (`ptr` is then untouched).
+	template<typename T>
+	T* reallocate(T* ptr, Ulen old_count, Ulen new_count, Bool zero) {
+            if (!ptr) {
+                return allocate<T>(new_count, zero);
+            }
+            const auto addr = reinterpret_cast<Address>(ptr);
+            if constexpr (alignof(T) > ALIGNMENT) {
+                return reinterpret_cast<T*>(grow_aligned(addr, old_count * sizeof(T), new_count * sizeof(T), alignof(T), zero));
+            } else {
+                return reinterpret_cast<T*>(grow(addr, old_count * sizeof(T), new_count * sizeof(T), zero));
+            }
 	}
 
         // --- Helpers for allocating+construct and destruct+deallocate objects ---
@@ -120,6 +175,11 @@ namespace ctl {
 	virtual void shrink(Address addr, Ulen old_len, Ulen new_len);
 	virtual Address grow(Address addr, Ulen old_len, Ulen new_len, Bool zero);
 
+	// Aligned blocks are placed by padding the cursor, they need no header.
+	virtual Address alloc_aligned(Ulen new_len, Ulen align, Bool zero);
+	virtual void free_aligned(Address addr, Ulen old_len, Ulen align);
+	virtual Address grow_aligned(Address addr, Ulen old_len, Ulen new_len, Ulen align, Bool zero);
+
         /// @brief Returns the total capacity of the arena.
 	constexpr Ulen length() const {
             return region_.end - region_.beg;
@@ -129,6 +189,80 @@ namespace ctl {
 	Address                      cursor_;
     };
 
+    /// @brief A linear allocator over a large reservation of address space.
+    ///
+    /// Reserves the whole range up front with no memory behind it, then commits
+    /// pages (COMMIT_SIZE at a time) as the cursor advances. The arena never
+    /// relocates: pointers stay stable and growing the last allocation is always
+    /// in place until the reservation is exhausted. `reset()` hands the committed
+    /// pages back to the OS. Like ArenaAllocator, only the last allocation can be
+    /// freed, shrunk or grown in place.
+    struct VirtualArena : Allocator {
+#if defined(CTL_ARCH_64BIT)
+	static inline constexpr const Ulen DEFAULT_RESERVE = 64_ulen << 30;
+#else
+	static inline constexpr const Ulen DEFAULT_RESERVE = 256_ulen << 20;
+#endif
+	static inline constexpr const Ulen COMMIT_SIZE = 64 << 10;
+
+        /// @brief Reserves `reserve` bytes of address space.
+        /// @return A new arena, or empty if the platform cannot reserve the range.
+	static Maybe<VirtualArena> create(Ulen reserve = DEFAULT_RESERVE);
+
+        /// @brief Move constructor. Takes ownership of the reservation.
+	VirtualArena(VirtualArena&& other)
+            : region_{exchange(other.region_.beg, 0), exchange(other.region_.end, 0)}
+            , cursor_{exchange(other.cursor_, 0)}
+            , commit_{exchange(other.commit_, 0)}
+            , dirty_{exchange(other.dirty_, 0)}
+	{}
+
+	VirtualArena(const VirtualArena&) = delete;
+
+        /// @brief Destructor. Releases the whole reservation.
+	~VirtualArena();
+
+        /// @brief Checks if a memory range belongs to this arena.
+	Bool owns(Address addr, Ulen len) const;
+
+        /// @brief Frees everything and decommits every page.
+	void reset();
+
+	virtual Address alloc(Ulen new_len, Bool zero);
+	virtual void free(Address addr, Ulen old_len);
+	virtual void shrink(Address addr, Ulen old_len, Ulen new_len);
+	virtual Address grow(Address addr, Ulen old_len, Ulen new_len, Bool zero);
+
+	// Aligned blocks are placed by padding the cursor, they need no header.
+	virtual Address alloc_aligned(Ulen new_len, Ulen align, Bool zero);
+	virtual void free_aligned(Address addr, Ulen old_len, Ulen align);
+	virtual Address grow_aligned(Address addr, Ulen old_len, Ulen new_len, Ulen align, Bool zero);
+
+        /// @brief Returns the number of bytes in use.
+	constexpr Ulen length() const { return cursor_ - region_.beg; }
+
+        /// @brief Returns the number of bytes backed by committed pages.
+	constexpr Ulen committed() const { return commit_ - region_.beg; }
+
+        /// @brief Returns the size of the reservation.
+	constexpr Ulen reserved() const { return region_.end - region_.beg; }
+    private:
+	constexpr VirtualArena(Address base, Ulen length)
+            : region_{base, base + length}
+            , cursor_{base}
+            , commit_{base}
+            , dirty_{base}
+	{}
+
+	// Commits pages until at least `end`.
+	Bool commit(Address end);
+
+	struct { Address beg, end; } region_;
+	Address                      cursor_;
+	Address                      commit_; // End of the committed pages
+	Address                      dirty_;  // End of the memory handed out since the last reset
+    };
+
     /// @brief An arena allocator that uses a stack-allocated buffer.
     /// @tparam E The size of the internal buffer in bytes.
     template<Ulen E>
@@ -154,6 +288,9 @@ namespace ctl {
             : allocator_{other.allocator_}
             , head_{exchange(other.head_, nullptr)}
             , tail_{exchange(other.tail_, nullptr)}
+            , slots_{exchange(other.slots_, nullptr)}
+            , capacity_{exchange(other.capacity_, 0)}
+            , used_{exchange(other.used_, 0)}
 	{}
 
         /// @brief Constructs a temporary allocator using a parent allocator for backing memory.
@@ -171,6 +308,10 @@ namespace ctl {
 	virtual void free(Address addr, Ulen old_len);
 	virtual void shrink(Address addr, Ulen old_len, Ulen new_len);
 	virtual Address grow(Address addr, Ulen old_len, Ulen new_len, Bool zero);
+
+	virtual Address alloc_aligned(Ulen new_len, Ulen align, Bool zero);
+	virtual void free_aligned(Address addr, Ulen old_len, Ulen align);
+	virtual Address grow_aligned(Address addr, Ulen old_len, Ulen new_len, Ulen align, Bool zero);
     private:
 	// Add a new block to the temporary allocator.
 	Bool add(Ulen len);
@@ -178,14 +319,35 @@ namespace ctl {
             Block(Ulen length)
                 : arena_{reinterpret_cast<Address>(data_), length}
             {}
+            Bool contains(Address addr) const {
+                const auto beg = reinterpret_cast<Address>(data_);
+                return addr >= beg && addr - beg < arena_.length();
+            }
             ArenaAllocator    arena_;
             Block*            prev_ = nullptr;
             Block*            next_ = nullptr;
             alignas(16) Uint8 data_[];
 	};
+
+	// Block index: an open addressing table mapping every 2 MiB chunk of
+	// address space a block overlaps to that block, so finding the owner of an
+	// address is one hash probe instead of a walk over the list. A block and its
+	// header take at least CHUNK_SIZE bytes, so a chunk overlaps at most two.
+	static inline constexpr const Ulen CHUNK_SHIFT = 21;
+	struct Slot {
+            Address chunk;     // Chunk number + 1, 0 marks an empty slot
+            Block*  blocks[2];
+	};
+	Block* find(Address addr) const;
+	Bool index(Block* block);
+	void insert(Address chunk, Block* block);
+
 	Allocator& allocator_;
-	Block*     head_ = nullptr;
-	Block*     tail_ = nullptr;
+	Block*     head_     = nullptr;
+	Block*     tail_     = nullptr;
+	Slot*      slots_    = nullptr;
+	Ulen       capacity_ = 0; // Power of two
+	Ulen       used_     = 0;
     };
 
     /// @brief A hybrid allocator optimized for small, local allocations.
@@ -237,6 +399,34 @@ namespace ctl {
             }
             return temporary_.grow(old_addr, old_len, new_len, zero);
 	}
+	virtual Address alloc_aligned(Ulen new_len, Ulen align, Bool zero) {
+            if (auto addr = inline_.alloc_aligned(new_len, align, zero)) return addr;
+            return temporary_.alloc_aligned(new_len, align, zero);
+	}
+	virtual void free_aligned(Address addr, Ulen old_len, Ulen align) {
+            if (inline_.owns(addr, old_len)) {
+                inline_.free_aligned(addr, old_len, align);
+            } else {
+                temporary_.free_aligned(addr, old_len, align);
+            }
+	}
+	virtual Address grow_aligned(Address old_addr, Ulen old_len, Ulen new_len, Ulen align, Bool zero) {
+            if (inline_.owns(old_addr, old_len)) {
+                if (auto new_addr = inline_.grow_aligned(old_addr, old_len, new_len, align, zero)) {
+                    return new_addr;
+                } else if (auto new_addr = temporary_.alloc_aligned(new_len, align, false)) {
+                    memcopy(new_addr, old_addr, old_len);
+                    if (zero) {
+                        memzero(new_addr + old_len, new_len - old_len);
+                    }
+                    inline_.free_aligned(old_addr, old_len, align);
+                    return new_addr;
+                } else {
+                    return 0;
+                }
+            }
+            return temporary_.grow_aligned(old_addr, old_len, new_len, align, zero);
+	}
     private:
 	InlineAllocator<E> inline_;
 	TemporaryAllocator temporary_;
@@ -244,10 +434,32 @@ namespace ctl {
 
     /// @brief Wraps the operating system's memory allocator (malloc/free/mmap/VirtualAlloc).
     struct SystemAllocator : Allocator {
+	constexpr SystemAllocator() = default;
+
+        /// @brief Constructs a system allocator, optionally backed by huge pages.
+        /// @param huge_pages If true, blocks too large for the size classes are
+        /// mapped with `Heap::allocate_huge`. Every such block then takes at least
+        /// one huge page, so this suits instances that back large regions such as
+        /// pools or temporary allocator blocks. A shrunk block keeps its first huge
+        /// page. Memory must be freed through an allocator in the same mode.
+	constexpr explicit SystemAllocator(Bool huge_pages)
+            : huge_pages_{huge_pages}
+	{}
+
+        /// @brief Returns whether large blocks are backed by huge pages.
+	[[nodiscard]] CTL_FORCEINLINE constexpr Bool huge_pages() const { return huge_pages_; }
+
 	virtual Address alloc(Ulen new_len, Bool zero);
 	virtual void free(Address addr, Ulen old_len);
 	virtual void shrink(Address, Ulen, Ulen);
 	virtual Address grow(Address addr, Ulen old_len, Ulen new_len, Bool zero);
+
+	// Large blocks are whole pages and already aligned up to the page size.
+	virtual Address alloc_aligned(Ulen new_len, Ulen align, Bool zero);
+	virtual void free_aligned(Address addr, Ulen old_len, Ulen align);
+	virtual Address grow_aligned(Address addr, Ulen old_len, Ulen new_len, Ulen align, Bool zero);
+    private:
+	Bool huge_pages_ = false;
     };
 
 } // namespace ctl
@@ -77,7 +77,7 @@ namespace ctl {
         /// 
         /// @return `true` on success, `false` if memory allocation failed.
 	Bool reserve(Ulen length) {
-            if (length < capacity_) {
+            if (length <= capacity_) {
                 return true;
             }
             Ulen capacity = MIN_CAPACITY;
@@ -85,6 +85,21 @@ namespace ctl {
                 capacity = (capacity * RESIZE_FACTOR) / 100;
             }
 
+            if constexpr (TriviallyRelocatable<T>) {
+                // Let the allocator extend the block in place, when it has to
+                // move it the elements go along as bytes. Without a block there
+                // is nothing to extend, so that takes the plain allocate below.
+                if (capacity_ != 0) {
+                    auto data = allocator_.reallocate(data_, capacity_, capacity, false);
+                    if (!data) {
+                        return false;
+                    }
+                    data_ = data;
+                    capacity_ = capacity;
+                    return true;
+                }
+            }
+
             auto data = allocator_.allocate<T>(capacity, false);
             if (!data) {
                 return false;
@@ -193,6 +208,7 @@ namespace ctl {
         /// @brief Destroys all elements and releases the memory to the allocator.
 	void reset() {
             drop();
+            data_ = nullptr;
             length_ = 0;
             capacity_ = 0;
 	}
@@ -247,6 +263,10 @@ namespace ctl {
 	Allocator& allocator_;
     };
 
+    // Holds no pointers into itself.
+    template<typename T>
+    inline constexpr bool is_trivially_relocatable<Array<T>> = true;
+
 } // namespace ctl
 
 #endif // CTL_ARRAY_HPP
@@ -0,0 +1,212 @@
+#ifndef CTL_ATOMIC_HPP
+#define CTL_ATOMIC_HPP
+#include "types.hpp"
+
+#if defined(CTL_COMPILER_MSVC)
+#include <intrin.h>
+#endif
+
+namespace ctl {
+
+    /// @brief Memory ordering constraints for atomic operations.
+    enum class MemoryOrder : Uint8 {
+	RELAXED,
+	ACQUIRE,
+	RELEASE,
+	ACQ_REL,
+	SEQ_CST,
+    };
+
+    /// @brief Hints the CPU that the caller is spinning on a contended location.
+    CTL_FORCEINLINE void cpu_relax() {
+#if defined(CTL_COMPILER_MSVC)
+	_mm_pause();
+#elif defined(CTL_ARCH_X64)
+	__builtin_ia32_pause();
+#elif defined(CTL_ARCH_ARM64)
+	__asm__ __volatile__("yield");
+#endif
+    }
+
+    /// @brief A word-sized value with atomic access.
+    ///
+    /// Thin wrapper over the compiler builtins, only supports 4 and 8 byte
+    /// integral or pointer types. Every operation takes an explicit MemoryOrder.
+    ///
+    /// @tparam T The type of the value (must be 4 or 8 bytes).
+    template<typename T>
+    struct Atomic {
+	static_assert(sizeof(T) == 4 || sizeof(T) == 8, "Atomic<T> requires a 4 or 8 byte type");
+
+	constexpr Atomic() = default;
+	constexpr Atomic(T value)
+            : value_{value}
+	{}
+
+	Atomic(const Atomic&) = delete;
+	Atomic& operator=(const Atomic&) = delete;
+
+	CTL_FORCEINLINE T load(MemoryOrder order = MemoryOrder::SEQ_CST) const {
+#if defined(CTL_COMPILER_MSVC)
+            (void)order;
+            const T value = *static_cast<const volatile T*>(&value_);
+            _ReadWriteBarrier();
+            return value;
+#else
+            return __atomic_load_n(&value_, convert(order));
+#endif
+	}
+
+	CTL_FORCEINLINE void store(T value, MemoryOrder order = MemoryOrder::SEQ_CST) {
+#if defined(CTL_COMPILER_MSVC)
+            if (order == MemoryOrder::SEQ_CST) {
+                exchange(value, order);
+            } else {
+                _ReadWriteBarrier();
+                *static_cast<volatile T*>(&value_) = value;
+            }
+#else
+            __atomic_store_n(&value_, value, convert(order));
+#endif
+	}
+
+	CTL_FORCEINLINE T exchange(T value, MemoryOrder order = MemoryOrder::SEQ_CST) {
+#if defined(CTL_COMPILER_MSVC)
+            (void)order;
+            if constexpr (sizeof(T) == 8) {
+                return from(_InterlockedExchange64(ptr64(), to(value)));
+            } else {
+                return from(_InterlockedExchange(ptr32(), to(value)));
+            }
+#else
+            return __atomic_exchange_n(&value_, value, convert(order));
+#endif
+	}
+
+        /// @brief Replaces the value with `desired` if it equals `expected`.
+        /// @return `true` on success, otherwise `expected` is updated with the current value.
+	CTL_FORCEINLINE Bool compare_exchange(T& expected, T desired,
+	                                      MemoryOrder success = MemoryOrder::SEQ_CST,
+	                                      MemoryOrder failure = MemoryOrder::RELAXED)
+	{
+#if defined(CTL_COMPILER_MSVC)
+            (void)success;
+            (void)failure;
+            if constexpr (sizeof(T) == 8) {
+                const auto prev = _InterlockedCompareExchange64(ptr64(), to(desired), to(expected));
+                if (prev == to(expected)) return true;
+                expected = from(prev);
+                return false;
+            } else {
+                const auto prev = _InterlockedCompareExchange(ptr32(), to(desired), to(expected));
+                if (prev == to(expected)) return true;
+                expected = from(prev);
+                return false;
+            }
+#else
+            return __atomic_compare_exchange_n(&value_, &expected, desired, true,
+                                               convert(success), convert(failure));
+#endif
+	}
+
+	CTL_FORCEINLINE T fetch_add(T value, MemoryOrder order = MemoryOrder::SEQ_CST) {
+#if defined(CTL_COMPILER_MSVC)
+            (void)order;
+            if constexpr (sizeof(T) == 8) {
+                return from(_InterlockedExchangeAdd64(ptr64(), to(value)));
+            } else {
+                return from(_InterlockedExchangeAdd(ptr32(), to(value)));
+            }
+#else
+            return __atomic_fetch_add(&value_, value, convert(order));
+#endif
+	}
+
+	CTL_FORCEINLINE T fetch_sub(T value, MemoryOrder order = MemoryOrder::SEQ_CST) {
+            return fetch_add(T(0) - value, order);
+	}
+
+	CTL_FORCEINLINE T fetch_or(T value, MemoryOrder order = MemoryOrder::SEQ_CST) {
+#if defined(CTL_COMPILER_MSVC)
+            (void)order;
+            if constexpr (sizeof(T) == 8) {
+                return from(_InterlockedOr64(ptr64(), to(value)));
+            } else {
+                return from(_InterlockedOr(ptr32(), to(value)));
+            }
+#else
+            return __atomic_fetch_or(&value_, value, convert(order));
+#endif
+	}
+
+	CTL_FORCEINLINE T fetch_and(T value, MemoryOrder order = MemoryOrder::SEQ_CST) {
+#if defined(CTL_COMPILER_MSVC)
+            (void)order;
+            if constexpr (sizeof(T) == 8) {
+                return from(_InterlockedAnd64(ptr64(), to(value)));
+            } else {
+                return from(_InterlockedAnd(ptr32(), to(value)));
+            }
+#else
+            return __atomic_fetch_and(&value_, value, convert(order));
+#endif
+	}
+
+    private:
+#if defined(CTL_COMPILER_MSVC)
+	volatile __int64* ptr64() { return reinterpret_cast<volatile __int64*>(&value_); }
+	volatile long* ptr32() { return reinterpret_cast<volatile long*>(&value_); }
+	static auto to(T value) {
+            if constexpr (sizeof(T) == 8) return __builtin_bit_cast(__int64, value);
+            else return __builtin_bit_cast(long, value);
+	}
+	template<typename U>
+	static T from(U value) { return __builtin_bit_cast(T, value); }
+#else
+	static constexpr int convert(MemoryOrder order) {
+            switch (order) {
+            case MemoryOrder::RELAXED: return __ATOMIC_RELAXED;
+            case MemoryOrder::ACQUIRE: return __ATOMIC_ACQUIRE;
+            case MemoryOrder::RELEASE: return __ATOMIC_RELEASE;
+            case MemoryOrder::ACQ_REL: return __ATOMIC_ACQ_REL;
+            case MemoryOrder::SEQ_CST: return __ATOMIC_SEQ_CST;
+            }
+            return __ATOMIC_SEQ_CST;
+	}
+#endif
+	T value_ = T();
+    };
+
+    /// @brief A minimal test-and-test-and-set spin lock.
+    ///
+    /// Intended for very short critical sections (a few pointer swaps). Not
+    /// recursive, not fair.
+    struct SpinLock {
+	constexpr SpinLock() = default;
+	SpinLock(const SpinLock&) = delete;
+	SpinLock& operator=(const SpinLock&) = delete;
+
+	void lock() {
+            while (flag_.exchange(1, MemoryOrder::ACQUIRE)) {
+                while (flag_.load(MemoryOrder::RELAXED)) {
+                    cpu_relax();
+                }
+            }
+	}
+
+	Bool try_lock() {
+            return flag_.load(MemoryOrder::RELAXED) == 0
+                && flag_.exchange(1, MemoryOrder::ACQUIRE) == 0;
+	}
+
+	void unlock() {
+            flag_.store(0, MemoryOrder::RELEASE);
+	}
+
+    private:
+	Atomic<Uint32> flag_;
+    };
+
+} // namespace ctl
+
+#endif // CTL_ATOMIC_HPP
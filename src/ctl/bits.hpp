@@ -0,0 +1,36 @@
+#ifndef CTL_BITS_HPP
+#define CTL_BITS_HPP
+#include "types.hpp"
+
+#if defined(CTL_COMPILER_MSVC)
+    #include <intrin.h>
+#endif
+
+namespace ctl {
+
+#if defined(CTL_COMPILER_MSVC)
+    // Count the number of trailing zero bits in [value] which is the same as
+    // giving the index to the first non-zero bit. 64 when [value] is zero.
+    CTL_FORCEINLINE Uint32 count_trailing_zeros(Uint64 value) {
+        unsigned long trailing_zero = 0;
+        if (_BitScanForward64(&trailing_zero, value)) {
+            return trailing_zero;
+        }
+        return 64;
+    }
+    CTL_FORCEINLINE Uint32 count_set_bits(Uint64 value) {
+        return Uint32(__popcnt64(value));
+    }
+#else
+    CTL_FORCEINLINE Uint32 count_trailing_zeros(Uint64 value) {
+        // __builtin_ctzll is undefined for zero, match the MSVC branch.
+        return value ? Uint32(__builtin_ctzll(value)) : 64;
+    }
+    CTL_FORCEINLINE Uint32 count_set_bits(Uint64 value) {
+        return Uint32(__builtin_popcountll(value));
+    }
+#endif
+
+} // namespace ctl
+
+#endif // CTL_BITS_HPP
@@ -68,6 +68,18 @@ namespace ctl {
         /// @return An Array containing the full file content.
 	Array<Uint8> map(Allocator& allocator) const;
 
+        /// @brief Maps the whole file as private copy-on-write memory.
+        ///
+        /// Nothing is read up front, pages fault in on first touch. Writes to the
+        /// mapping are private to the process. The mapping stays valid after the
+        /// file is closed, release it with `unmap`.
+        /// @return The mapped bytes, or an empty slice if the file is empty or the
+        /// platform cannot map files.
+	[[nodiscard]] Slice<Uint8> map_private() const;
+
+        /// @brief Releases a mapping returned by `map_private`.
+	static void unmap(Slice<Uint8> mapping);
+
     private:
 	File* drop() {
             close();
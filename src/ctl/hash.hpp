@@ -0,0 +1,64 @@
+#ifndef CTL_HASH_HPP
+#define CTL_HASH_HPP
+#include "string.hpp"
+
+namespace ctl {
+
+    /// @brief Hashes `length` bytes at `data`, any alignment.
+    Hash hash_bytes(const void* data, Ulen length, Hash seed = 0);
+
+    /// @brief Hashes an integer with one multiply, folding the high half of
+    /// the product into the low half so both ends of the result are mixed.
+    template<typename T>
+	requires Integral<T> || Same<RemoveCVRef<T>, Ulen> || Same<RemoveCVRef<T>, char>
+    CTL_FORCEINLINE constexpr Hash hash(T value) {
+	const auto h = Uint64(value) * 0x9e3779b97f4a7c15_u64;
+	return h ^ (h >> 32);
+    }
+
+    /// @brief Hashes a pointer by its address. Character pointers are strings
+    /// and go through the StringView overload instead.
+    template<typename T>
+	requires (!Same<RemoveCV<T>, char>)
+    CTL_FORCEINLINE Hash hash(T* pointer) {
+	return hash(Uint64(reinterpret_cast<Address>(pointer)));
+    }
+
+    /// @brief Hashes the characters of a string.
+    CTL_FORCEINLINE Hash hash(StringView string) {
+	return hash_bytes(string.data(), string.length());
+    }
+
+    /// @brief Hashes the characters of an owned string, the same as its StringView.
+    CTL_FORCEINLINE Hash hash(const Array<char>& string) {
+	return hash(string.slice());
+    }
+
+    /// @brief Key equality used by HashMap. Defaults to `==`, overloaded
+    /// where the key and the lookup type have no `==` between them.
+    template<typename K, typename Q>
+    CTL_FORCEINLINE constexpr Bool equal(const K& key, const Q& query)
+	requires requires { { key == query } -> Same<Bool>; }
+    {
+	return key == query;
+    }
+
+    CTL_FORCEINLINE Bool equal(const Array<char>& key, StringView query) {
+	return key.slice() == query;
+    }
+
+    CTL_FORCEINLINE Bool equal(const Array<char>& key, const Array<char>& query) {
+	return key.slice() == query.slice();
+    }
+
+    /// @brief Concept satisfied when a `Q` can look up a key of type `K`: it
+    /// hashes to the same value as an equal key and compares with `equal`.
+    template<typename K, typename Q>
+    concept HashLookup = requires(const K& key, const Q& query) {
+	{ hash(query) } -> Same<Hash>;
+	{ equal(key, query) } -> Same<Bool>;
+    };
+
+} // namespace ctl
+
+#endif // CTL_HASH_HPP
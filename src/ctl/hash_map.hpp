@@ -0,0 +1,438 @@
+#ifndef CTL_HASH_MAP_HPP
+#define CTL_HASH_MAP_HPP
+#include "array.hpp"
+#include "bits.hpp"
+#include "hash.hpp"
+
+#if defined(CTL_ARCH_X64)
+    #include <emmintrin.h>
+#elif defined(CTL_ARCH_ARM64)
+    #include <arm_neon.h>
+#endif
+
+namespace ctl {
+
+    /// @brief WIDTH control bytes of a HashMap, compared in one go.
+    ///
+    /// A control byte is EMPTY (zero) or the top bit set and seven bits of the
+    /// hash of the entry in its slot below. SSE2 and NEON compare all bytes with
+    /// one instruction, elsewhere a loop builds the same masks.
+    struct HashGroup {
+	static inline constexpr const Ulen  WIDTH = 16;
+	static inline constexpr const Uint8 EMPTY = 0;
+
+        /// @brief The bytes of a group that matched, walked from the lowest.
+        /// @code for (auto mask = group.match(tag); mask; mask.next()) { mask.lowest(); } @endcode
+	struct Mask {
+#if defined(CTL_ARCH_ARM64)
+            // NEON has no movemask, each byte comes out as a nibble.
+            static inline constexpr const Uint32 SHIFT = 2;
+#else
+            static inline constexpr const Uint32 SHIFT = 0;
+#endif
+            CTL_FORCEINLINE explicit constexpr operator Bool() const { return bits != 0; }
+            CTL_FORCEINLINE Ulen lowest() const { return count_trailing_zeros(bits) >> SHIFT; }
+            CTL_FORCEINLINE void next() { bits &= bits - 1; }
+            Uint64 bits;
+	};
+
+#if defined(CTL_ARCH_X64)
+	CTL_FORCEINLINE explicit HashGroup(const Uint8* ctrl)
+            : group_{_mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl))}
+	{}
+	CTL_FORCEINLINE Mask match(Uint8 tag) const {
+            return { Uint32(_mm_movemask_epi8(_mm_cmpeq_epi8(group_, _mm_set1_epi8(char(tag))))) };
+	}
+	CTL_FORCEINLINE Mask empty() const {
+            // Full bytes have the top bit set, so the movemask is the full set.
+            return { ~Uint32(_mm_movemask_epi8(group_)) & 0xffff_u32 };
+	}
+    private:
+	__m128i group_;
+#elif defined(CTL_ARCH_ARM64)
+	CTL_FORCEINLINE explicit HashGroup(const Uint8* ctrl)
+            : group_{vld1q_u8(ctrl)}
+	{}
+	CTL_FORCEINLINE Mask match(Uint8 tag) const {
+            return { pack(vceqq_u8(group_, vdupq_n_u8(tag))) };
+	}
+	CTL_FORCEINLINE Mask empty() const {
+            return { pack(vceqq_u8(group_, vdupq_n_u8(EMPTY))) };
+	}
+    private:
+	// Narrows the 0x00/0xff bytes of a compare to 4 bits each, keeping one bit
+	// per byte so Mask::next clears a whole byte.
+	static CTL_FORCEINLINE Uint64 pack(uint8x16_t bytes) {
+            const auto nibbles = vshrn_n_u16(vreinterpretq_u16_u8(bytes), 4);
+            return vget_lane_u64(vreinterpret_u64_u8(nibbles), 0) & 0x8888888888888888_u64;
+	}
+	uint8x16_t group_;
+#else
+	CTL_FORCEINLINE explicit HashGroup(const Uint8* ctrl) {
+            for (Ulen i = 0; i < WIDTH; i++) {
+                group_[i] = ctrl[i];
+            }
+	}
+	CTL_FORCEINLINE Mask match(Uint8 tag) const {
+            Uint64 bits = 0;
+            for (Ulen i = 0; i < WIDTH; i++) {
+                bits |= Uint64(group_[i] == tag) << i;
+            }
+            return { bits };
+	}
+	CTL_FORCEINLINE Mask empty() const {
+            return match(EMPTY);
+	}
+    private:
+	Uint8 group_[WIDTH];
+#endif
+    };
+
+    /// @brief An open addressing hash map in the style of a Swiss table.
+    ///
+    /// Entries live in a power of two array of slots with one control byte per
+    /// slot. A lookup starts at the slot the hash picks and compares the 7-bit
+    /// tags of a whole HashGroup at once, so most misses and collisions never
+    /// touch a key. Probing is linear and removal shifts the entries that
+    /// follow back into the hole, so there are no tombstones: a probe stops at
+    /// the first empty byte and the map never needs a rehash to clean up.
+    ///
+    /// Keys need `hash` and `equal` overloads (see hash.hpp), found by ADL for
+    /// user types. Lookups take any type `Q` with `HashLookup<K, Q>`, so a map
+    /// keyed on strings is searched with a StringView or a literal.
+    ///
+    /// @tparam K The type of keys.
+    /// @tparam V The type of values.
+    template<typename K, typename V>
+    struct HashMap {
+        /// @brief The key and value stored in a slot. Iteration yields these,
+        /// the key must not be modified.
+	struct Entry {
+            K key;
+            V value;
+	};
+
+        /// @brief Constructs an empty map, nothing is allocated until the first insert.
+	HashMap(Allocator& allocator)
+            : ctrl_{allocator}
+	{}
+
+        /// @brief Move constructor. Transfers ownership of the table.
+	HashMap(HashMap&& other)
+            : ctrl_{move(other.ctrl_)}
+            , slots_{exchange(other.slots_, nullptr)}
+            , length_{exchange(other.length_, 0)}
+            , capacity_{exchange(other.capacity_, 0)}
+	{}
+
+	HashMap(const HashMap&) = delete;
+	~HashMap() { drop(); }
+
+	HashMap& operator=(const HashMap&) = delete;
+
+        /// @brief Move assignment operator.
+        /// Destroys the current content and takes ownership of `other`.
+	HashMap& operator=(HashMap&& other) {
+            return *new (drop(), Nat{}) HashMap{move(other)};
+	}
+
+        /// @brief Makes room for `length` entries so inserting up to that many never rehashes.
+        /// @return `true` on success, `false` if memory allocation failed.
+	Bool reserve(Ulen length) {
+            if (length <= max_load(capacity_)) {
+                return true;
+            }
+            Ulen capacity = capacity_ ? capacity_ : HashGroup::WIDTH;
+            while (length > max_load(capacity)) {
+                capacity *= 2;
+            }
+            return rehash(capacity);
+	}
+
+        /// @brief Inserts `key` with `value`, or assigns `value` if the key is already present.
+        /// @return `true` on success, `false` if memory allocation failed.
+	Bool insert(K&& key, V&& value) {
+            return put(move(key), move(value));
+	}
+
+        /// @brief Inserts copies of `key` and `value`, or assigns `value` if the key is already present.
+        /// @return `true` on success, `false` if memory allocation failed.
+	Bool insert(const K& key, const V& value)
+            requires CopyConstructible<K> && CopyConstructible<V>
+	{
+            return put(key, value);
+	}
+
+        /// @brief Returns a pointer to the value for `key`, or `nullptr` if it is absent.
+        /// The pointer is valid until the map is next modified.
+	template<typename Q>
+	V* find(const Q& key)
+            requires HashLookup<K, Q>
+	{
+            const auto index = locate(key, hash(key));
+            return index != NONE ? &slots_[index].value : nullptr;
+	}
+
+	template<typename Q>
+	const V* find(const Q& key) const
+            requires HashLookup<K, Q>
+	{
+            const auto index = locate(key, hash(key));
+            return index != NONE ? &slots_[index].value : nullptr;
+	}
+
+        /// @brief Returns a copy of the value for `key`, or empty if it is absent.
+	template<typename Q>
+	Maybe<V> get(const Q& key) const
+            requires HashLookup<K, Q> && CopyConstructible<V>
+	{
+            if (const auto value = find(key)) {
+                return Maybe<V>{V{*value}};
+            }
+            return {};
+	}
+
+        /// @brief Checks if `key` is present.
+	template<typename Q>
+	Bool contains(const Q& key) const
+            requires HashLookup<K, Q>
+	{
+            return locate(key, hash(key)) != NONE;
+	}
+
+        /// @brief Removes `key` and returns its value, or empty if it is absent.
+	template<typename Q>
+	Maybe<V> take(const Q& key)
+            requires HashLookup<K, Q>
+	{
+            const auto index = locate(key, hash(key));
+            if (index == NONE) {
+                return {};
+            }
+            Maybe<V> value{move(slots_[index].value)};
+            erase(index);
+            return value;
+	}
+
+        /// @brief Removes `key`.
+        /// @return `true` if the key was present.
+	template<typename Q>
+	Bool remove(const Q& key)
+            requires HashLookup<K, Q>
+	{
+            const auto index = locate(key, hash(key));
+            if (index == NONE) {
+                return false;
+            }
+            erase(index);
+            return true;
+	}
+
+        /// @brief Removes all entries but keeps the table.
+	void clear() {
+            destruct();
+            for (auto& ctrl : ctrl_) {
+                ctrl = HashGroup::EMPTY;
+            }
+            length_ = 0;
+	}
+
+	[[nodiscard]] CTL_FORCEINLINE constexpr auto length() const { return length_; }
+	[[nodiscard]] CTL_FORCEINLINE constexpr auto capacity() const { return capacity_; }
+	[[nodiscard]] CTL_FORCEINLINE constexpr auto is_empty() const { return length_ == 0; }
+	[[nodiscard]] CTL_FORCEINLINE constexpr Allocator& allocator() const { return ctrl_.allocator(); }
+
+        /// @brief Walks the entries in slot order.
+	template<typename E>
+	struct Iterator {
+            CTL_FORCEINLINE E& operator*() const { return slots_[index_]; }
+            CTL_FORCEINLINE Iterator& operator++() {
+                index_ = skip(ctrl_, index_ + 1, capacity_);
+                return *this;
+            }
+            CTL_FORCEINLINE Bool operator!=(const Iterator& other) const { return index_ != other.index_; }
+            E*           slots_;
+            const Uint8* ctrl_;
+            Ulen         index_;
+            Ulen         capacity_;
+	};
+
+	// Just enough to make range based for loops work
+	[[nodiscard]] Iterator<Entry> begin() { return { slots_, ctrl_.data(), skip(ctrl_.data(), 0, capacity_), capacity_ }; }
+	[[nodiscard]] Iterator<const Entry> begin() const { return { slots_, ctrl_.data(), skip(ctrl_.data(), 0, capacity_), capacity_ }; }
+	[[nodiscard]] Iterator<Entry> end() { return { slots_, ctrl_.data(), capacity_, capacity_ }; }
+	[[nodiscard]] Iterator<const Entry> end() const { return { slots_, ctrl_.data(), capacity_, capacity_ }; }
+
+    private:
+	static inline constexpr const Ulen NONE = ~0_ulen;
+
+	// At most 7/8 of the slots are used, so every probe finds an empty byte.
+	static CTL_FORCEINLINE constexpr Ulen max_load(Ulen capacity) {
+            return capacity - capacity / 8;
+	}
+
+	// The low bits of the hash pick the slot and the top seven are the tag,
+	// so the tag still tells apart keys that start at the same slot.
+	static CTL_FORCEINLINE constexpr Uint8 tag(Hash h) {
+            return Uint8(h >> 57) | 0x80_u8;
+	}
+
+	static CTL_FORCEINLINE Ulen skip(const Uint8* ctrl, Ulen index, Ulen capacity) {
+            while (index < capacity && ctrl[index] == HashGroup::EMPTY) {
+                index++;
+            }
+            return index;
+	}
+
+	// Returns the slot holding `key`, or NONE. Entries sit between the slot
+	// their hash picks and the next empty byte, so the first group with an
+	// empty byte ends the search.
+	template<typename Q>
+	Ulen locate(const Q& key, Hash h) const {
+            if (length_ == 0) {
+                return NONE;
+            }
+            const auto mask = capacity_ - 1;
+            const auto t = tag(h);
+            for (Ulen pos = h & mask; ; pos = (pos + HashGroup::WIDTH) & mask) {
+                const HashGroup group{ctrl_.data() + pos};
+                for (auto match = group.match(t); match; match.next()) {
+                    const auto index = (pos + match.lowest()) & mask;
+                    if (equal(slots_[index].key, key)) {
+                        return index;
+                    }
+                }
+                if (group.empty()) {
+                    return NONE;
+                }
+            }
+	}
+
+	// Returns the first empty slot from the one `h` picks.
+	Ulen vacant(Hash h) const {
+            const auto mask = capacity_ - 1;
+            for (Ulen pos = h & mask; ; pos = (pos + HashGroup::WIDTH) & mask) {
+                if (const auto empty = HashGroup{ctrl_.data() + pos}.empty()) {
+                    return (pos + empty.lowest()) & mask;
+                }
+            }
+	}
+
+	// The first WIDTH control bytes are mirrored past the end, so a group
+	// loaded near the end of the table reads the start of it.
+	CTL_FORCEINLINE void set(Ulen index, Uint8 ctrl) {
+            ctrl_[index] = ctrl;
+            if (index < HashGroup::WIDTH) {
+                ctrl_[capacity_ + index] = ctrl;
+            }
+	}
+
+	template<typename KK, typename VV>
+	Bool put(KK&& key, VV&& value) {
+            const auto h = hash(key);
+            const auto index = locate(key, h);
+            if (index != NONE) {
+                slots_[index].value = forward<VV>(value);
+                return true;
+            }
+            if (!reserve(length_ + 1)) {
+                return false;
+            }
+            const auto slot = vacant(h);
+            new (slots_ + slot, Nat{}) Entry{forward<KK>(key), forward<VV>(value)};
+            set(slot, tag(h));
+            length_++;
+            return true;
+	}
+
+	// Backward shift deletion: walks the entries after the hole up to the next
+	// empty byte and moves each one whose home slot is not between the hole
+	// and itself into the hole, which moves the hole to where it was.
+	void erase(Ulen index) {
+            if constexpr (!TriviallyDestructible<Entry>) {
+                slots_[index].~Entry();
+            }
+            const auto mask = capacity_ - 1;
+            auto hole = index;
+            for (auto next = (hole + 1) & mask; ctrl_[next] != HashGroup::EMPTY; next = (next + 1) & mask) {
+                const auto home = hash(slots_[next].key) & mask;
+                const auto stays = hole < next
+                    ? hole < home && home <= next
+                    : hole < home || home <= next;
+                if (stays) {
+                    continue;
+                }
+                new (slots_ + hole, Nat{}) Entry{move(slots_[next])};
+                if constexpr (!TriviallyDestructible<Entry>) {
+                    slots_[next].~Entry();
+                }
+                set(hole, ctrl_[next]);
+                hole = next;
+            }
+            set(hole, HashGroup::EMPTY);
+            length_--;
+	}
+
+	Bool rehash(Ulen capacity) {
+            Array<Uint8> ctrl{allocator()};
+            if (!ctrl.resize(capacity + HashGroup::WIDTH)) {
+                return false;
+            }
+            auto slots = allocator().template allocate<Entry>(capacity, false);
+            if (!slots) {
+                return false;
+            }
+            auto old_ctrl = exchange(ctrl_, move(ctrl));
+            auto old_slots = exchange(slots_, slots);
+            auto old_capacity = exchange(capacity_, capacity);
+            for (Ulen i = 0; i < old_capacity; i++) {
+                if (old_ctrl[i] == HashGroup::EMPTY) {
+                    continue;
+                }
+                const auto h = hash(old_slots[i].key);
+                const auto slot = vacant(h);
+                new (slots_ + slot, Nat{}) Entry{move(old_slots[i])};
+                if constexpr (!TriviallyDestructible<Entry>) {
+                    old_slots[i].~Entry();
+                }
+                set(slot, tag(h));
+            }
+            if (old_slots) {
+                allocator().deallocate(old_slots, old_capacity);
+            }
+            return true;
+	}
+
+        /// @brief Helper to call destructors on all entries.
+	void destruct() {
+            if constexpr (!TriviallyDestructible<Entry>) {
+                for (Ulen i = 0; i < capacity_; i++) {
+                    if (ctrl_[i] != HashGroup::EMPTY) {
+                        slots_[i].~Entry();
+                    }
+                }
+            }
+	}
+
+	HashMap* drop() {
+            destruct();
+            if (slots_) {
+                allocator().deallocate(slots_, capacity_);
+            }
+            ctrl_ = Array<Uint8>{allocator()};
+            return this;
+	}
+
+	Array<Uint8> ctrl_;
+	Entry*       slots_    = nullptr;
+	Ulen         length_   = 0;
+	Ulen         capacity_ = 0;
+    };
+
+    // Holds no pointers into itself.
+    template<typename K, typename V>
+    inline constexpr bool is_trivially_relocatable<HashMap<K, V>> = true;
+
+} // namespace ctl
+
+#endif // CTL_HASH_MAP_HPP
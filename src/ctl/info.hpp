@@ -94,4 +94,12 @@
     #define CTL_FORMAT_PRINTF(fmt_idx, args_idx)
 #endif
 
+// Hints that the cache line at `addr` will be read soon. A no-op where the
+// compiler has no builtin for it.
+#if defined(CTL_COMPILER_GCC) || defined(CTL_COMPILER_CLANG)
+    #define CTL_PREFETCH(addr) __builtin_prefetch(addr)
+#else
+    #define CTL_PREFETCH(addr) ((void)(addr))
+#endif
+
 #endif // CTL_INFO_H
@@ -137,6 +137,9 @@ namespace ctl {
 	Bool valid_ = false;
     };
 
+    template<typename T>
+    inline constexpr bool is_trivially_relocatable<Maybe<T>> = is_trivially_relocatable<T>;
+
 } // namespace ctl
 
 #endif // CTL_MAYBE_H
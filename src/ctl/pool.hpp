@@ -3,6 +3,9 @@
 // #include "util/types.h"
 #include "maybe.hpp"
 #include "allocator.hpp"
+#include "atomic.hpp"
+#include "slice.hpp"
+#include "bits.hpp"
 
 namespace ctl {
 
@@ -20,6 +23,7 @@ namespace ctl {
     // deallocate(). The address (pointer) of the object can be looked-up by passing
     // the PoolRef to operator[] like a key.
     struct Stream;
+    struct PoolHeader;
 
     /// @brief A fixed-size, fixed-capacity object allocator (Object Pool).
     /// 
@@ -33,11 +37,30 @@ namespace ctl {
         /// @return A new Pool or empty on allocation failure.
 	static Maybe<Pool> create(Allocator& allocator, Ulen size, Ulen capacity);
 
+        /// @brief Creates a Pool whose objects live in caller provided memory.
+        ///
+        /// Only the bitmap is allocated from `allocator`. `data` must be zeroed,
+        /// hold `size * capacity` bytes (capacity rounded up to a multiple of 64)
+        /// and outlive the pool.
+	static Maybe<Pool> create(Allocator& allocator, Ulen size, Ulen capacity, Uint8* data);
+
         /// @brief Loads a Pool from a binary stream.
+        ///
+        /// When the stream is memory backed (`Stream::map`, e.g. `MappedStream`)
+        /// the pool uses the snapshot bytes in place instead of copying them, and
+        /// must be destroyed before the stream is closed.
 	static Maybe<Pool> load(Allocator& allocator, Stream& stream);
 
+        /// @brief Snapshot formats written by `save`. `load` reads both.
+	enum class Format : Uint32 {
+            DENSE  = 1, ///< The whole bitmap and every slot, loadable in place from a MappedStream.
+            SPARSE = 2, ///< Only the live slots, as runs of the bitmap.
+	};
+
         /// @brief Serializes the Pool state (and data) to a binary stream.
-	Bool save(Stream& stream) const;
+        /// DENSE by default, which older readers understand and which loads in
+        /// place. Pass SPARSE for smaller snapshots of mostly empty pools.
+	Bool save(Stream& stream, Format format = Format::DENSE) const;
 
 	Pool(Pool&& other);
         ~Pool() { drop(); }
@@ -46,6 +69,12 @@ namespace ctl {
 	[[nodiscard]] CTL_FORCEINLINE constexpr auto length() const { return length_; }
 	[[nodiscard]] CTL_FORCEINLINE constexpr auto is_empty() const { return length_ == 0; }
 
+        /// @brief Returns the maximum number of objects, a multiple of 64.
+	[[nodiscard]] CTL_FORCEINLINE constexpr auto capacity() const { return capacity_; }
+
+        /// @brief Returns the allocator backing the pool.
+	[[nodiscard]] CTL_FORCEINLINE constexpr Allocator& allocator() const { return allocator_; }
+
 	constexpr Pool(const Pool&) = delete;
 	constexpr Pool& operator=(const Pool&) = delete;
 
@@ -60,6 +89,13 @@ namespace ctl {
         /// @brief Deallocates the slot at the given reference.
 	void deallocate(PoolRef ref);
 
+        /// @brief Allocates up to `refs.length()` slots, claiming a whole bitmap word at a time.
+        /// @return The number of slots written to the front of `refs`, less than requested only when the pool is full.
+	Ulen allocate_n(Slice<PoolRef> refs);
+
+        /// @brief Deallocates every slot in `refs`. Runs of slots in the same word are cleared at once, so sorted refs free fastest.
+	void deallocate_n(Slice<const PoolRef> refs);
+
         /// @brief Accesses the memory at the given reference.
         /// @return Raw pointer to the object data (must be cast to T*).
 	CTL_FORCEINLINE constexpr auto operator[](PoolRef ref) { return data_ + size_ * ref.index; }
@@ -67,32 +103,364 @@ namespace ctl {
         /// @brief Accesses the memory at the given reference (const).
 	CTL_FORCEINLINE constexpr auto operator[](PoolRef ref) const { return data_ + size_ * ref.index; }
 
+        /// @brief Calls `fn(PoolRef)` for every allocated slot in index order.
+        ///
+        /// Walks `used_` a word at a time, so 64 free slots cost one load, and
+        /// prefetches the objects a few slots ahead. `fn` may deallocate the slot
+        /// it is given; slots allocated by `fn` may or may not be visited.
+	template<typename F>
+	void for_each(F&& fn) {
+            Cursor cursor{used_, capacity_ / BITS};
+            Cursor ahead{used_, capacity_ / BITS};
+            for (Ulen i = 0; i < PREFETCH; i++) {
+                if (const auto index = ahead.next(); index != Cursor::END) {
+                    CTL_PREFETCH(data_ + size_ * index);
+                }
+            }
+            for (auto index = cursor.next(); index != Cursor::END; index = cursor.next()) {
+                if (const auto next = ahead.next(); next != Cursor::END) {
+                    CTL_PREFETCH(data_ + size_ * next);
+                }
+                fn(PoolRef { index });
+            }
+	}
+
     private:
 	using Word = Uint64;
 	static constexpr const auto BITS = Uint32(sizeof(Word) * 8);
-	constexpr Pool(Allocator& allocator, Ulen size, Ulen length, Ulen capacity, Uint8* data, Word* used)
+
+	// How many objects for_each() prefetches ahead of the one it visits.
+	static constexpr const Ulen PREFETCH = 8;
+
+	// Yields the indices of set bits in `used_`, skipping zero words. Holds a
+	// copy of the current word, so clearing the bit just returned is safe.
+	struct Cursor {
+            static constexpr const Uint32 END = ~0_u32;
+            Cursor(const Word* words, Ulen n_words)
+                : words_{words}
+                , n_words_{n_words}
+                , bits_{n_words ? words[0] : 0}
+            {}
+            CTL_FORCEINLINE Uint32 next() {
+                while (bits_ == 0) {
+                    if (++w_index_ >= n_words_) {
+                        w_index_ = n_words_;
+                        return END;
+                    }
+                    bits_ = words_[w_index_];
+                }
+                const auto b_index = count_trailing_zeros(bits_);
+                bits_ &= bits_ - 1;
+                return Uint32(w_index_ * BITS + b_index);
+            }
+            const Word* words_;
+            Ulen        n_words_;
+            Ulen        w_index_ = 0;
+            Word        bits_;
+	};
+
+	// Free slots are found through a summary bitmap over `used_`: bit N of a
+	// level 1 word is set when word N of `used_` has a free slot, bit N of a
+	// level 2 word when word N of level 1 is non-zero, and so on up to a single
+	// top word. allocate() descends from the top with one ctz per level. Five
+	// levels cover the whole 32-bit PoolRef range. The summary lives after the
+	// `used_` words in the same allocation, or in an allocation of its own when
+	// `used_` points into a mapped snapshot, and is rebuilt from `used_` on load,
+	// so it is not part of the serialized format.
+	static constexpr const Uint32 MAX_LEVELS = 5;
+
+	// Largest capacity a PoolRef can address. create() and load() refuse
+	// anything larger before calling layout().
+	static constexpr const Uint64 MAX_CAPACITY = 1_u64 << 32;
+
+	// Computes the summary layout for a pool of `n_words` words of `used_`.
+	// Fills `offsets` with the offset of each level from `used_` and returns
+	// the total number of words (`used_` included). Never writes more than
+	// MAX_LEVELS levels, which cover MAX_CAPACITY.
+	static constexpr Ulen layout(Ulen n_words, Ulen (&offsets)[MAX_LEVELS], Uint32& levels) {
+            Ulen total = n_words;
+            levels = 0;
+            for (Ulen n = n_words; levels < MAX_LEVELS && (levels == 0 || n > 1); levels++) {
+                n = (n + BITS - 1) / BITS;
+                offsets[levels] = total;
+                total += n;
+            }
+            return total;
+	}
+
+	// Which of the pool memory is owned. With MAPPED `data` and `used` belong
+	// to a Stream mapping and only `tree` (the summary words) is owned,
+	// otherwise `tree` follows `used` in one allocation. With BORROWED `data`
+	// belongs to the caller.
+	enum class Storage : Uint8 {
+            OWNED,
+            MAPPED,
+            BORROWED,
+	};
+
+	Pool(Allocator& allocator, Ulen size, Ulen length, Ulen capacity, Uint8* data, Word* used, Word* tree, Storage storage)
             : allocator_{allocator}
             , size_{size}
             , length_{length}
             , capacity_{capacity}
             , data_{data}
             , used_{used}
+            , tree_{tree}
             , last_{0}
-	{}
+            , storage_{storage}
+	{
+            words_ = layout(capacity / BITS, summary_, levels_);
+            for (Uint32 i = 0; i < levels_; i++) {
+                summary_[i] -= capacity / BITS;
+            }
+            summarize();
+	}
+
+	static Maybe<Pool> load_sparse(Allocator& allocator, Stream& stream, const PoolHeader& header);
+	Bool save_sparse(Stream& stream) const;
+
+	// Rebuilds the summary levels from `used_`.
+	void summarize();
+	// Returns the index of a word of `used_` with a free slot, or empty when full.
+	Maybe<Uint32> find();
+	// Marks `bits` of word `w_index` used (or free) and updates length and summary.
+	void claim(Uint32 w_index, Word bits);
+	void release(Uint32 w_index, Word bits);
+
+	// Moves the objects to `data`, which the pool borrows from then on. A
+	// mapped bitmap is copied out too, so the pool no longer needs the stream.
+	friend struct Slab;
+	Bool relocate(Uint8* data);
+
+	CTL_FORCEINLINE Word* summary(Uint32 level) { return tree_ + summary_[level]; }
 
 	Pool* drop() {
-            allocator_.deallocate(data_, size_ * capacity_);
-            allocator_.deallocate(used_, capacity_ / BITS);
+            if (storage_ == Storage::MAPPED) {
+                allocator_.deallocate(tree_, words_ - capacity_ / BITS);
+                return this;
+            }
+            if (storage_ == Storage::OWNED) {
+                allocator_.deallocate(data_, size_ * capacity_);
+            }
+            allocator_.deallocate(used_, words_);
             return this;
 	}
 
 	Allocator& allocator_;
 	Ulen       size_;      // Size of an object in the pool
 	Ulen       length_;    // # of objects in the pool
-	Ulen       capacity_;  // Always a multiple of 32 (max # of objects in pool)
+	Ulen       capacity_;  // Always a multiple of 64 (max # of objects in pool)
 	Uint8*     data_;      // Object memory
 	Word*      used_;      // Bitset where bit N indicates object N is in-use or not.
+	Word*      tree_;      // Summary words
 	Uint32     last_;      // Last w_index
+	Storage    storage_;   // Which of data_ and used_ the pool frees
+	Uint32     levels_ = 0;            // # of summary levels
+	Ulen       summary_[MAX_LEVELS];   // Offset of each summary level from tree_
+	Ulen       words_  = 0;            // # of words of used_ and summary together
+    };
+
+    // Summary levels are offsets from tree_, the pool holds no pointers into itself.
+    template<>
+    inline constexpr bool is_trivially_relocatable<Pool> = true;
+
+    /// @brief A fixed-size, fixed-capacity object allocator safe to share between threads.
+    ///
+    /// Same layout and `PoolRef` semantics as `Pool`, but slots are claimed with an
+    /// atomic fetch-or on the `used_` words and released with a fetch-and, so any
+    /// number of threads can allocate and deallocate without a lock. Each thread
+    /// starts its search at its own hint word, spread evenly over the pool, which
+    /// keeps threads on different cache lines until the pool gets crowded.
+    ///
+    /// There is no summary bitmap: a thread scans forward from its hint, and the
+    /// length is reserved up front so a full pool fails without scanning.
+    struct ConcurrentPool {
+        /// @brief Creates a new ConcurrentPool.
+        /// @param allocator Backing allocator for the pool memory.
+        /// @param size Size of a single object in bytes.
+        /// @param capacity Maximum number of objects.
+        /// @return A new ConcurrentPool or empty on allocation failure.
+	static Maybe<ConcurrentPool> create(Allocator& allocator, Ulen size, Ulen capacity);
+
+        /// @brief Moves a pool. Neither pool may be in use by another thread.
+	ConcurrentPool(ConcurrentPool&& other);
+        ~ConcurrentPool() { drop(); }
+
+	constexpr ConcurrentPool(const ConcurrentPool&) = delete;
+	constexpr ConcurrentPool& operator=(const ConcurrentPool&) = delete;
+
+	ConcurrentPool& operator=(ConcurrentPool&& other) {
+            return *new (drop(), Nat{}) ConcurrentPool{move(other)};
+	}
+
+        /// @brief Returns the number of active objects in the pool.
+        /// @note Only a snapshot while other threads allocate or deallocate.
+	[[nodiscard]] CTL_FORCEINLINE Ulen length() const { return length_.load(MemoryOrder::RELAXED); }
+	[[nodiscard]] CTL_FORCEINLINE Bool is_empty() const { return length() == 0; }
+
+        /// @brief Allocates a slot for a new object.
+        /// @return A reference (index) to the allocated slot, or empty if full.
+	Maybe<PoolRef> allocate();
+
+        /// @brief Deallocates the slot at the given reference.
+	void deallocate(PoolRef ref);
+
+        /// @brief Accesses the memory at the given reference.
+        /// @return Raw pointer to the object data (must be cast to T*).
+	CTL_FORCEINLINE constexpr auto operator[](PoolRef ref) { return data_ + size_ * ref.index; }
+
+        /// @brief Accesses the memory at the given reference (const).
+	CTL_FORCEINLINE constexpr auto operator[](PoolRef ref) const { return data_ + size_ * ref.index; }
+
+    private:
+	using Word = Uint64;
+	static constexpr const auto BITS = Uint32(sizeof(Word) * 8);
+
+	// Threads are handed hint slots round-robin, slot N holds the word where
+	// the threads on it last found a free slot.
+	static constexpr const Uint32 HINTS = 64;
+
+	ConcurrentPool(Allocator& allocator, Ulen size, Ulen capacity, Uint8* data, Atomic<Word>* used);
+
+	ConcurrentPool* drop() {
+            allocator_.deallocate(data_, size_ * capacity_);
+            allocator_.deallocate(used_, capacity_ / BITS);
+            return this;
+	}
+
+	Allocator&     allocator_;
+	Ulen           size_;      // Size of an object in the pool
+	Ulen           capacity_;  // Always a multiple of 64 (max # of objects in pool)
+	Uint8*         data_;      // Object memory
+	Atomic<Word>*  used_;      // Bitset where bit N indicates object N is in-use or not.
+	Atomic<Ulen>   length_;    // # of objects in the pool, reserved before a bit is claimed
+	Atomic<Uint32> hints_[HINTS];
+    };
+
+    /// @brief A handle to an object in a TypedPool, checked against the slot generation.
+    template<typename T>
+    struct PoolHandle {
+	Uint32 index;
+	Uint32 generation;
+    };
+
+    /// @brief A Pool of T that runs constructors and destructors.
+    ///
+    /// Every slot has a generation counter that is bumped when an object is
+    /// constructed in it and again when it is destroyed, so it is odd exactly
+    /// while the slot is in use. A handle to a destroyed object is detected even
+    /// after the slot was reused, and one to a free slot never matches. Live
+    /// objects are visited in slot order with `for_each`, which walks the pool
+    /// bitmap instead of a separate index array.
+    ///
+    /// @tparam T The object type, at most Allocator::ALIGNMENT aligned.
+    template<typename T>
+    struct TypedPool {
+	static_assert(alignof(T) <= Allocator::ALIGNMENT, "TypedPool<T> does not support over-aligned T");
+
+        /// @brief Creates a TypedPool with room for at least `capacity` objects.
+	static Maybe<TypedPool> create(Allocator& allocator, Ulen capacity) {
+            auto pool = Pool::create(allocator, sizeof(T), capacity);
+            if (!pool) {
+                return {};
+            }
+            auto generations = allocator.allocate<Uint32>(pool->capacity(), true);
+            if (!generations) {
+                return {};
+            }
+            return TypedPool { move(*pool), generations };
+	}
+
+	TypedPool(TypedPool&& other)
+            : pool_{move(other.pool_)}
+            , generations_{exchange(other.generations_, nullptr)}
+	{}
+
+	~TypedPool() { drop(); }
+
+	TypedPool(const TypedPool&) = delete;
+	TypedPool& operator=(const TypedPool&) = delete;
+
+	TypedPool& operator=(TypedPool&& other) {
+            drop();
+            pool_ = move(other.pool_);
+            generations_ = exchange(other.generations_, nullptr);
+            return *this;
+	}
+
+	[[nodiscard]] CTL_FORCEINLINE constexpr auto length() const { return pool_.length(); }
+	[[nodiscard]] CTL_FORCEINLINE constexpr auto is_empty() const { return pool_.is_empty(); }
+
+        /// @brief Constructs a T from `args` in a free slot.
+        /// @return The handle of the new object, or empty if the pool is full.
+	template<typename... Ts>
+	Maybe<PoolHandle<T>> emplace(Ts&&... args) {
+            const auto ref = pool_.allocate();
+            if (!ref) {
+                return {};
+            }
+            new (pool_[*ref], Nat{}) T{forward<Ts>(args)...};
+            return PoolHandle<T> { ref->index, ++generations_[ref->index] };
+	}
+
+        /// @brief Destroys the object behind `handle`.
+        /// @return `false` if the handle was already stale.
+	Bool destroy(PoolHandle<T> handle) {
+            const auto object = (*this)[handle];
+            if (!object) {
+                return false;
+            }
+            object->~T();
+            generations_[handle.index]++;
+            pool_.deallocate(PoolRef { handle.index });
+            return true;
+	}
+
+        /// @brief Looks up the object behind `handle`.
+        /// @return The object, or nullptr if it was destroyed or the slot is free.
+	CTL_FORCEINLINE T* operator[](PoolHandle<T> handle) {
+            if (handle.index >= pool_.capacity() || !(handle.generation & 1) || generations_[handle.index] != handle.generation) {
+                return nullptr;
+            }
+            return reinterpret_cast<T*>(pool_[PoolRef { handle.index }]);
+	}
+
+	CTL_FORCEINLINE const T* operator[](PoolHandle<T> handle) const {
+            return const_cast<TypedPool&>(*this)[handle];
+	}
+
+        /// @brief Calls `fn(PoolHandle<T>, T&)` for every live object in slot order.
+        /// @note `fn` may destroy the object it is given through its handle.
+	template<typename F>
+	void for_each(F&& fn) {
+            pool_.for_each([&](PoolRef ref) {
+                fn(handle(ref), *reinterpret_cast<T*>(pool_[ref]));
+            });
+	}
+
+        /// @brief Returns the current handle of the object in slot `ref`.
+	[[nodiscard]] CTL_FORCEINLINE PoolHandle<T> handle(PoolRef ref) const {
+            return PoolHandle<T> { ref.index, generations_[ref.index] };
+	}
+
+    private:
+	TypedPool(Pool&& pool, Uint32* generations)
+            : pool_{move(pool)}
+            , generations_{generations}
+	{}
+
+	void drop() {
+            if (generations_) {
+                if constexpr (!TriviallyDestructible<T>) {
+                    for_each([](PoolHandle<T>, T& object) { object.~T(); });
+                }
+                pool_.allocator().deallocate(generations_, pool_.capacity());
+                generations_ = nullptr;
+            }
+	}
+
+	Pool    pool_;
+	Uint32* generations_; // Bumped on every emplace and destroy, odd while the slot is in use
     };
 
 }
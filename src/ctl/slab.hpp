@@ -2,6 +2,8 @@
 #define CTL_SLAB_HPP
 #include "pool.hpp"
 #include "array.hpp"
+#include "atomic.hpp"
+#include "bits.hpp"
 
 namespace ctl {
 
@@ -10,27 +12,53 @@ namespace ctl {
 	Uint32 index;
     };
 
+    /// @brief An object moved by `Slab::compact`, from its old reference to its new one.
+    struct SlabMove {
+	SlabRef from;
+	SlabRef to;
+    };
+
+    /// @brief Pool lifetime counters of a Slab.
+    struct SlabStats {
+	Uint64 created  = 0; ///< Pools created because no pool had a free slot.
+	Uint64 recycled = 0; ///< Retained empty pools that were used again.
+	Uint64 evicted  = 0; ///< Empty pools destroyed by the retention policy.
+    };
+
     /// @brief A growable pool allocator.
     /// 
     /// Composed of multiple fixed-size `Pool`s (caches). When one is full,
     /// a new one is allocated. Provides stable indices (`SlabRef`) across growths.
+    ///
+    /// Pools that become empty are kept for reuse, up to the retention limit, so
+    /// an alloc/free pattern oscillating around a pool boundary does not create
+    /// and destroy a pool every time. Above the limit the empty pool with the
+    /// highest index is destroyed, which keeps the live caches packed at the
+    /// front and lets the tail of the cache array be trimmed.
     struct Stream;
     struct Slab {
+        /// @brief Default number of empty pools kept for reuse.
+	static constexpr const Ulen DEFAULT_RETAIN = 1;
+
         /// @brief Constructs a Slab allocator.
         /// @param allocator Allocator for the internal arrays and pools.
         /// @param size Size of a single object in bytes.
-        /// @param capacity Capacity per internal cache (Chunk size).
-	constexpr Slab(Allocator& allocator, Ulen size, Ulen capacity)
+        /// @param capacity Capacity per internal cache (Chunk size), rounded up to a multiple of 64 like `Pool`.
+        /// @param retain Number of empty pools kept for reuse.
+	constexpr Slab(Allocator& allocator, Ulen size, Ulen capacity, Ulen retain = DEFAULT_RETAIN)
             : caches_{allocator}
+            , links_{allocator}
+            , bases_{allocator}
             , size_{size}
-            , capacity_{capacity}
+            , capacity_{round(capacity)}
+            , retain_{retain}
 	{}
 
         /// @brief Loads a Slab from a stream.
 	static Maybe<Slab> load(Allocator& allocator, Stream& stream);
 
-        /// @brief Saves the Slab to a stream.
-	Bool save(Stream& stream) const;
+        /// @brief Saves the Slab to a stream, every pool in the given format.
+	Bool save(Stream& stream, Pool::Format format = Pool::Format::DENSE) const;
 
         /// @brief Allocates a new object. Automatically grows if necessary.
 	Maybe<SlabRef> allocate();
@@ -38,28 +66,464 @@ namespace ctl {
         /// @brief Deallocates the object at the given reference.
 	void deallocate(SlabRef slab_ref);
 
+        /// @brief Allocates up to `refs.length()` objects, a whole pool word at a time.
+        /// @return The number of objects written to the front of `refs`, less than requested only when a pool could not be created.
+	Ulen allocate_n(Slice<SlabRef> refs);
+
+        /// @brief Deallocates every object in `refs`. Refs in the same pool are freed as one batch, so sorted refs free fastest.
+	void deallocate_n(Slice<const SlabRef> refs);
+
+        /// @brief Moves objects out of the emptiest pools into the fullest ones.
+        ///
+        /// Moves at most `moves.length()` objects, so a large slab can be
+        /// compacted a bounded step at a time, e.g. once per frame. Every move
+        /// is recorded in `moves`, and the old refs are dangling once this
+        /// returns. Pools that empty out go to the retention policy, `trim()`
+        /// frees all of them. Objects are moved with a plain memory copy.
+        /// Repeated calls leave at most one partially filled pool.
+        /// @return The number of moves written to the front of `moves`, 0 once there is nothing left to compact.
+	Ulen compact(Slice<SlabMove> moves);
+
+        /// @brief Sets how many empty pools are kept, destroying any above the new limit.
+	void retain(Ulen count);
+
+        /// @brief Destroys every retained empty pool. The limit is unchanged.
+	void trim();
+
+        /// @brief Returns the pool lifetime counters.
+	[[nodiscard]] CTL_FORCEINLINE constexpr const SlabStats& stats() const { return stats_; }
+
+        /// @brief Calls `fn(SlabRef)` for every allocated object, pool by pool in index order.
+        ///
+        /// `fn` may deallocate the object it is given; pools that empty out are
+        /// only released to the retention policy once the walk is done. `fn`
+        /// must not allocate.
+	template<typename F>
+	void for_each(F&& fn) {
+            walking_ = true;
+            for (Ulen i = 0; i < caches_.length(); i++) {
+                if (auto& cache = caches_[i]) {
+                    const auto base = Uint32(i * capacity_);
+                    cache->for_each([&](PoolRef ref) { fn(SlabRef { base + ref.index }); });
+                }
+            }
+            walking_ = false;
+            evict(retain_);
+            trim_tail();
+	}
+
         /// @brief Access raw memory at the given reference.
 	CTL_FORCEINLINE constexpr Uint8* operator[](SlabRef slab_ref) {
             const auto cache_idx = Uint32(slab_ref.index / capacity_);
             const auto cache_ref = Uint32(slab_ref.index % capacity_);
-            return (*caches_[cache_idx])[PoolRef { cache_ref }];
+            return bases_[cache_idx] + size_ * cache_ref;
 	}
 
         /// @brief Access raw memory at the given reference (const).
 	CTL_FORCEINLINE constexpr const Uint8* operator[](SlabRef slab_ref) const {
             const auto cache_idx = Uint32(slab_ref.index / capacity_);
             const auto cache_ref = Uint32(slab_ref.index % capacity_);
-            return (*caches_[cache_idx])[PoolRef { cache_ref }];
+            return bases_[cache_idx] + size_ * cache_ref;
 	}
+
+	[[nodiscard]] CTL_FORCEINLINE constexpr Ulen size() const { return size_; }
+	[[nodiscard]] CTL_FORCEINLINE constexpr Ulen capacity() const { return capacity_; }
     private:
+	template<Ulen, Ulen>
+	friend struct StaticSlab;
+	friend struct VirtualSlab;
+
 	Slab(Array<Maybe<Pool>>&& caches, Ulen size, Ulen capacity)
             : caches_{move(caches)}
+            , links_{caches_.allocator()}
+            , bases_{caches_.allocator()}
             , size_{size}
-            , capacity_{capacity}
+            , capacity_{round(capacity)}
 	{}
+
+	// Pools with free slots are kept on intrusive lists, one per fill level
+	// (BUCKETS levels of length / capacity). allocate() takes the head of the
+	// fullest non-empty list, so partially used pools fill up before emptier
+	// ones are touched. Retained empty pools are on the extra EMPTY list and
+	// only used once every other pool is full. Full and invalid caches are on
+	// no list.
+	static constexpr const Uint32 BUCKETS = 8;
+	static constexpr const Uint32 EMPTY = BUCKETS;
+	static constexpr const Uint32 NIL = ~0_u32;
+	struct Link {
+            Uint32 prev   = NIL;
+            Uint32 next   = NIL;
+            Uint32 bucket = NIL;
+	};
+
+	// Returns the list a pool belongs on, NIL when it is full.
+	Uint32 bucket_of(const Pool& pool) const;
+	void link(Uint32 index, Uint32 bucket);
+	void unlink(Uint32 index);
+	// Moves cache `index` to the list matching its current length.
+	void update(Uint32 index);
+	// Pools round their capacity up to whole bitmap words. The slab uses the
+	// same capacity so every slot a pool hands out maps to a unique SlabRef.
+	static constexpr Ulen round(Ulen capacity) { return (capacity + 63) / 64 * 64; }
+	// Creates the pool for cache `index`, in its chunk of the region when there is one.
+	Maybe<Pool> create(Ulen index);
+	// Moves every pool into its chunk of the region.
+	Bool place();
+	// Returns the index of the pool to allocate from, adding one when every pool is full.
+	Maybe<Uint32> acquire();
+	// Relists pool `index` after slots were freed in it and applies the retention policy.
+	void released(Uint32 index);
+	// Sizes links_ to caches_ and puts every valid cache on its list.
+	Bool relink();
+	// Destroys retained empty pools, highest index first, until at most `keep` remain.
+	void evict(Ulen keep);
+	// Pops invalid caches off the end.
+	void trim_tail();
+
 	Array<Maybe<Pool>> caches_;
+	Array<Link>        links_;
+	Array<Uint8*>      bases_; // Object memory of each cache, nullptr when invalid
 	Ulen               size_;
 	Ulen               capacity_;
+	Ulen               retain_ = DEFAULT_RETAIN;
+	Ulen               empty_  = 0; // # of pools on the EMPTY list
+	Uint32             heads_[BUCKETS + 1] = { NIL, NIL, NIL, NIL, NIL, NIL, NIL, NIL, NIL };
+	Uint32             fill_   = 0; // Bit b set when list b < BUCKETS is non-empty
+	SlabStats          stats_;
+	Bool               walking_ = false; // Inside for_each(), eviction is deferred
+	Uint8*             region_  = nullptr; // Reservation pools are placed in, owned by VirtualSlab
+	Ulen               limit_   = 0; // # of pools the region has room for
+    };
+
+    /// @brief A Slab whose pools sit back to back in one reserved address range.
+    ///
+    /// Pool N occupies bytes [N * size * capacity, (N + 1) * size * capacity) of
+    /// the reservation, so the object behind a `SlabRef` is at `base + index *
+    /// size` with no table in between. A pool's pages are committed when the
+    /// pool is created and decommitted when the retention policy destroys it,
+    /// so memory use follows the live pools while addresses stay fixed.
+    ///
+    /// The capacity is rounded up so each pool covers whole pages. Refs, the
+    /// retention policy and snapshots are the runtime `Slab`'s.
+    struct VirtualSlab {
+        /// @brief Reserves room for `max_objects` objects of `size` bytes.
+        /// @param allocator Allocator for the internal arrays and pool bitmaps.
+        /// @param capacity Objects per pool, rounded up to fill whole pages.
+        /// @param retain Number of empty pools kept committed for reuse.
+        /// @return Empty if the platform cannot reserve address space.
+	static Maybe<VirtualSlab> create(Allocator& allocator, Ulen size, Ulen capacity, Ulen max_objects, Ulen retain = Slab::DEFAULT_RETAIN);
+
+        /// @brief Loads a snapshot into a new reservation of `max_objects` objects.
+        /// @return Empty if the snapshot does not fit or its pools do not cover whole pages.
+	static Maybe<VirtualSlab> load(Allocator& allocator, Stream& stream, Ulen max_objects);
+
+	VirtualSlab(VirtualSlab&& other);
+	VirtualSlab(const VirtualSlab&) = delete;
+	VirtualSlab& operator=(const VirtualSlab&) = delete;
+
+        /// @brief Destroys every pool and releases the reservation.
+	~VirtualSlab();
+
+	Bool save(Stream& stream, Pool::Format format = Pool::Format::DENSE) const {
+            return slab_.save(stream, format);
+	}
+
+        /// @brief Allocates a new object, empty once the reservation is full.
+	Maybe<SlabRef> allocate() { return slab_.allocate(); }
+	void deallocate(SlabRef slab_ref) { slab_.deallocate(slab_ref); }
+	Ulen allocate_n(Slice<SlabRef> refs) { return slab_.allocate_n(refs); }
+	void deallocate_n(Slice<const SlabRef> refs) { slab_.deallocate_n(refs); }
+	Ulen compact(Slice<SlabMove> moves) { return slab_.compact(moves); }
+	void retain(Ulen count) { slab_.retain(count); }
+	void trim() { slab_.trim(); }
+	[[nodiscard]] CTL_FORCEINLINE constexpr const SlabStats& stats() const { return slab_.stats(); }
+
+	template<typename F>
+	void for_each(F&& fn) { slab_.for_each(forward<F>(fn)); }
+
+        /// @brief Access raw memory at the given reference.
+	CTL_FORCEINLINE Uint8* operator[](SlabRef slab_ref) {
+            return base_ + size_ * slab_ref.index;
+	}
+
+        /// @brief Access raw memory at the given reference (const).
+	CTL_FORCEINLINE const Uint8* operator[](SlabRef slab_ref) const {
+            return base_ + size_ * slab_ref.index;
+	}
+
+	[[nodiscard]] CTL_FORCEINLINE constexpr Ulen size() const { return size_; }
+	[[nodiscard]] CTL_FORCEINLINE constexpr Ulen capacity() const { return slab_.capacity(); }
+
+        /// @brief Returns the size of the reservation in bytes.
+	[[nodiscard]] CTL_FORCEINLINE constexpr Ulen reserved() const { return slab_.limit_ * size_ * slab_.capacity(); }
+    private:
+	friend struct ShardedSlab;
+
+	VirtualSlab(Slab&& slab, Uint8* base, Ulen limit);
+
+	// Rounds `capacity` up to a multiple of 64 whose pools fill whole pages.
+	static Ulen round(Ulen size, Ulen capacity);
+	// Returns the number of pools needed for `max_objects`, capped to the SlabRef range.
+	static Ulen pools(Ulen capacity, Ulen max_objects);
+
+	Uint8* base_;
+	Ulen   size_;
+	Slab   slab_;
+    };
+
+    /// @brief A Slab with the object size and pool capacity fixed at compile time.
+    ///
+    /// Allocation, retention and snapshots are the runtime `Slab`'s, so refs and
+    /// snapshot files are interchangeable between the two. Only the lookup
+    /// differs: with a power of two `Capacity` the pool index and offset are a
+    /// shift and a mask, the object offset a multiply by a constant, and the
+    /// pool memory comes straight from the slab's flat table of pool pointers.
+    ///
+    /// @tparam Size Size of a single object in bytes.
+    /// @tparam Capacity Objects per pool, a power of two of at least 64.
+    template<Ulen Size, Ulen Capacity>
+    struct StaticSlab {
+	static_assert(Size > 0, "StaticSlab requires a non-zero object size");
+	static_assert(Capacity >= 64 && (Capacity & (Capacity - 1)) == 0,
+	              "StaticSlab requires a power of two capacity of at least 64");
+
+        /// @brief Constructs a StaticSlab.
+        /// @param allocator Allocator for the internal arrays and pools.
+        /// @param retain Number of empty pools kept for reuse.
+	constexpr StaticSlab(Allocator& allocator, Ulen retain = Slab::DEFAULT_RETAIN)
+            : slab_{allocator, Size, Capacity, retain}
+	{}
+
+        /// @brief Loads a snapshot written by `Slab::save` or `StaticSlab::save`.
+        /// @return Empty if the snapshot has a different object size or capacity.
+	static Maybe<StaticSlab> load(Allocator& allocator, Stream& stream) {
+            auto slab = Slab::load(allocator, stream);
+            if (!slab || slab->size() != Size || slab->capacity() != Capacity) {
+                return {};
+            }
+            return StaticSlab { move(*slab) };
+	}
+
+	Bool save(Stream& stream, Pool::Format format = Pool::Format::DENSE) const {
+            return slab_.save(stream, format);
+	}
+
+	Maybe<SlabRef> allocate() { return slab_.allocate(); }
+	void deallocate(SlabRef slab_ref) { slab_.deallocate(slab_ref); }
+	Ulen allocate_n(Slice<SlabRef> refs) { return slab_.allocate_n(refs); }
+	void deallocate_n(Slice<const SlabRef> refs) { slab_.deallocate_n(refs); }
+	Ulen compact(Slice<SlabMove> moves) { return slab_.compact(moves); }
+	void retain(Ulen count) { slab_.retain(count); }
+	void trim() { slab_.trim(); }
+	[[nodiscard]] CTL_FORCEINLINE constexpr const SlabStats& stats() const { return slab_.stats(); }
+
+	template<typename F>
+	void for_each(F&& fn) { slab_.for_each(forward<F>(fn)); }
+
+        /// @brief Access raw memory at the given reference.
+	CTL_FORCEINLINE Uint8* operator[](SlabRef slab_ref) {
+            return slab_.bases_[slab_ref.index >> SHIFT] + (slab_ref.index & MASK) * Size;
+	}
+
+        /// @brief Access raw memory at the given reference (const).
+	CTL_FORCEINLINE const Uint8* operator[](SlabRef slab_ref) const {
+            return slab_.bases_[slab_ref.index >> SHIFT] + (slab_ref.index & MASK) * Size;
+	}
+
+    private:
+	static constexpr Uint32 log2(Ulen value) {
+            Uint32 shift = 0;
+            while ((Ulen(1) << shift) < value) {
+                shift++;
+            }
+            return shift;
+	}
+	static constexpr const Uint32 SHIFT = log2(Capacity);
+	static constexpr const Uint32 MASK  = Uint32(Capacity - 1);
+
+	StaticSlab(Slab&& slab)
+            : slab_{move(slab)}
+	{}
+
+	Slab slab_;
+    };
+
+    /// @brief A Slab shared by many threads, each allocating from a shard of its own.
+    ///
+    /// A thread claims a free shard on its first allocation and is the only one
+    /// to touch that shard's `VirtualSlab` from then on, so allocation takes no
+    /// lock. The top SHARD_BITS of a `SlabRef` name the shard. Freeing an object
+    /// of another thread's shard pushes it onto that shard's remote free list,
+    /// a lock-free stack linked through the freed objects themselves. The owner
+    /// takes the whole list with one exchange and frees it in batches on its
+    /// next allocation. Lookups read the shard base from a table that only
+    /// changes when a shard is first created, and are safe from any thread.
+    ///
+    /// A thread that stops allocating should call `release()` so another thread
+    /// can adopt its shard and the objects still in it. A thread that exits
+    /// without releasing keeps its shard claimed for the slab's lifetime.
+    /// `allocator` must be safe to use from every thread.
+    struct ShardedSlab {
+	static inline constexpr const Uint32 SHARD_BITS = 4;
+	static inline constexpr const Uint32 SHARDS     = 1_u32 << SHARD_BITS;
+        /// @brief Objects a shard can hold at most, the SlabRef bits left over.
+	static inline constexpr const Ulen   MAX_OBJECTS = Ulen(1) << (32 - SHARD_BITS);
+
+        /// @brief Constructs a ShardedSlab. Shards reserve their memory when first claimed.
+        /// @param allocator Allocator for the pool bitmaps, used from every thread.
+        /// @param size Size of a single object in bytes, rounded up to a multiple of 4 to link remote frees.
+        /// @param capacity Objects per pool, rounded up like `VirtualSlab`.
+        /// @param max_objects Objects per shard, at most MAX_OBJECTS.
+	ShardedSlab(Allocator& allocator, Ulen size, Ulen capacity, Ulen max_objects = MAX_OBJECTS);
+
+	ShardedSlab(const ShardedSlab&) = delete;
+	ShardedSlab(ShardedSlab&&) = delete;
+
+        /// @brief Allocates from the calling thread's shard, claiming one if it has none.
+        /// @return Empty when every shard is claimed by another thread or the shard is full.
+	Maybe<SlabRef> allocate();
+
+        /// @brief Deallocates from any thread. Objects of another thread's shard are queued for it.
+	void deallocate(SlabRef slab_ref);
+
+        /// @brief Frees the remote frees queued for the calling thread's shard and gives it up.
+	void release();
+
+        /// @brief Access raw memory at the given reference.
+	CTL_FORCEINLINE Uint8* operator[](SlabRef slab_ref) {
+            return bases_[slab_ref.index >> LOCAL_BITS] + size_ * (slab_ref.index & LOCAL_MASK);
+	}
+
+        /// @brief Access raw memory at the given reference (const).
+	CTL_FORCEINLINE const Uint8* operator[](SlabRef slab_ref) const {
+            return bases_[slab_ref.index >> LOCAL_BITS] + size_ * (slab_ref.index & LOCAL_MASK);
+	}
+
+	[[nodiscard]] CTL_FORCEINLINE constexpr Ulen size() const { return size_; }
+    private:
+	static inline constexpr const Uint32 LOCAL_BITS = 32 - SHARD_BITS;
+	static inline constexpr const Uint32 LOCAL_MASK = Uint32(MAX_OBJECTS - 1);
+	static inline constexpr const Uint32 NONE       = ~0_u32;
+
+	// Remote frees are written by every thread, the owner and the slab only
+	// by the owning thread, so they sit on cache lines of their own.
+	struct alignas(64) Shard {
+            Atomic<Uint32>                remote; // Head of the remote free list, local index + 1, 0 when empty
+            alignas(64) Atomic<Uint32>    owner;  // Ordinal of the owning thread, NONE when free
+            Maybe<VirtualSlab>            slab;
+	};
+
+	// Returns the calling thread's shard, claiming a free one if it has none.
+	Shard* shard();
+	// Frees every object on the remote free list of `shard`.
+	void drain(Shard& shard);
+
+	Allocator& allocator_;
+	Ulen       size_;
+	Ulen       capacity_;
+	Ulen       max_objects_;
+	Uint8*     bases_[SHARDS] = {}; // Base of each shard's reservation, set once when created
+	Shard      shards_[SHARDS];
+    };
+
+    /// @brief A handle to an object in a TypedSlab, checked against the slot generation.
+    template<typename T>
+    struct SlabHandle {
+	Uint32 index;
+	Uint32 generation;
+    };
+
+    /// @brief A Slab of T that runs constructors and destructors.
+    ///
+    /// Like `TypedPool`, every slot has a generation counter bumped when its
+    /// object is constructed and destroyed, odd while the slot is in use, so
+    /// stale handles and handles to free slots are detected. The counters outlive
+    /// evicted pools, a handle into a pool that was destroyed and re-created is
+    /// still rejected.
+    ///
+    /// @tparam T The object type, at most Allocator::ALIGNMENT aligned.
+    template<typename T>
+    struct TypedSlab {
+	static_assert(alignof(T) <= Allocator::ALIGNMENT, "TypedSlab<T> does not support over-aligned T");
+
+        /// @brief Constructs a TypedSlab.
+        /// @param allocator Allocator for the pools and the generation counters.
+        /// @param capacity Objects per internal pool.
+        /// @param retain Number of empty pools kept for reuse.
+	TypedSlab(Allocator& allocator, Ulen capacity, Ulen retain = Slab::DEFAULT_RETAIN)
+            : slab_{allocator, sizeof(T), capacity, retain}
+            , generations_{allocator}
+	{}
+
+	TypedSlab(TypedSlab&&) = default;
+	TypedSlab(const TypedSlab&) = delete;
+	TypedSlab& operator=(const TypedSlab&) = delete;
+
+	~TypedSlab() {
+            if constexpr (!TriviallyDestructible<T>) {
+                for_each([](SlabHandle<T>, T& object) { object.~T(); });
+            }
+	}
+
+        /// @brief Constructs a T from `args`, growing the slab if needed.
+        /// @return The handle of the new object, or empty on allocation failure.
+	template<typename... Ts>
+	Maybe<SlabHandle<T>> emplace(Ts&&... args) {
+            const auto ref = slab_.allocate();
+            if (!ref) {
+                return {};
+            }
+            if (ref->index >= generations_.length() && !generations_.resize(ref->index + 1)) {
+                slab_.deallocate(*ref);
+                return {};
+            }
+            new (slab_[*ref], Nat{}) T{forward<Ts>(args)...};
+            return SlabHandle<T> { ref->index, ++generations_[ref->index] };
+	}
+
+        /// @brief Destroys the object behind `handle`.
+        /// @return `false` if the handle was already stale.
+	Bool destroy(SlabHandle<T> handle) {
+            const auto object = (*this)[handle];
+            if (!object) {
+                return false;
+            }
+            object->~T();
+            generations_[handle.index]++;
+            slab_.deallocate(SlabRef { handle.index });
+            return true;
+	}
+
+        /// @brief Looks up the object behind `handle`.
+        /// @return The object, or nullptr if it was destroyed or the slot is free.
+	CTL_FORCEINLINE T* operator[](SlabHandle<T> handle) {
+            if (handle.index >= generations_.length() || !(handle.generation & 1) || generations_[handle.index] != handle.generation) {
+                return nullptr;
+            }
+            return reinterpret_cast<T*>(slab_[SlabRef { handle.index }]);
+	}
+
+	CTL_FORCEINLINE const T* operator[](SlabHandle<T> handle) const {
+            return const_cast<TypedSlab&>(*this)[handle];
+	}
+
+        /// @brief Calls `fn(SlabHandle<T>, T&)` for every live object, pool by pool in slot order.
+        /// @note `fn` may destroy the object it is given through its handle but must not create new ones.
+	template<typename F>
+	void for_each(F&& fn) {
+            slab_.for_each([&](SlabRef ref) {
+                fn(handle(ref), *reinterpret_cast<T*>(slab_[ref]));
+            });
+	}
+
+        /// @brief Returns the current handle of the object in slot `ref`.
+	[[nodiscard]] CTL_FORCEINLINE SlabHandle<T> handle(SlabRef ref) const {
+            return SlabHandle<T> { ref.index, generations_[ref.index] };
+	}
+
+    private:
+	Slab          slab_;
+	Array<Uint32> generations_; // Bumped on every emplace and destroy, odd while the slot is in use
     };
 
 } // namespace ctl
@@ -55,6 +55,11 @@ namespace ctl {
             , length_{exchange(other.length_, 0)}
 	{}
 
+        /// @brief Views a mutable slice as a const one.
+	constexpr operator Slice<const T>() const requires (!is_same<T, const T>) {
+            return Slice<const T>{data_, length_};
+	}
+
 	[[nodiscard]] CTL_FORCEINLINE constexpr T& operator[](Ulen index) { return data_[index]; }
 	[[nodiscard]] CTL_FORCEINLINE constexpr const T& operator[](Ulen index) const { return data_[index]; }
 
@@ -0,0 +1,274 @@
+#ifndef CTL_SMALL_ARRAY_HPP
+#define CTL_SMALL_ARRAY_HPP
+#include "array.hpp"
+
+namespace ctl {
+
+    /// @brief A dynamic array that keeps its first N elements inline.
+    ///
+    /// Same API as `Array`. Up to N elements live in storage inside the object,
+    /// so short arrays never touch the allocator. Past N the elements spill to
+    /// a block from the allocator and it grows like an `Array`, through
+    /// `Allocator::grow` when T is trivially relocatable. `reset()` frees the
+    /// block and returns to the inline storage.
+    ///
+    /// @tparam T The type of elements stored.
+    /// @tparam N The number of elements stored inline.
+    template<typename T, Ulen N>
+    struct SmallArray {
+	static_assert(N > 0, "SmallArray requires inline room for at least one element");
+
+        /// @brief Constructs an empty array associated with the given allocator.
+	SmallArray(Allocator& allocator)
+            : data_{storage()}
+            , allocator_{allocator}
+	{}
+
+        /// @brief Move constructor. Takes the block of a spilled array, moves inline elements one by one.
+	SmallArray(SmallArray&& other)
+            : data_{storage()}
+            , allocator_{other.allocator_}
+	{
+            if (other.is_inline()) {
+                for (Ulen i = 0; i < other.length_; i++) {
+                    new (data_ + i, Nat{}) T{move(other.data_[i])};
+                }
+                length_ = other.length_;
+                other.destruct();
+                other.length_ = 0;
+            } else {
+                data_     = exchange(other.data_, other.storage());
+                length_   = exchange(other.length_, 0);
+                capacity_ = exchange(other.capacity_, N);
+            }
+	}
+
+        // Copying is disabled to prevent implicit allocations. Use `copy()` instead.
+	SmallArray(const SmallArray&) = delete;
+
+	~SmallArray() { drop(); }
+
+	SmallArray& operator=(const SmallArray&) = delete;
+
+        /// @brief Move assignment operator.
+        /// Destroys the current content and takes ownership of `other`.
+	SmallArray& operator=(SmallArray&& other) {
+            return *new (drop(), Nat{}) SmallArray{move(other)};
+	}
+
+        /// @brief Resizes the array to contain `length` elements.
+        ///
+        /// If `length` is smaller than current, elements are destructed.
+        /// If `length` is larger, new elements are default-constructed.
+        ///
+        /// @return `true` on success, `false` if memory allocation failed.
+	Bool resize(Ulen length) {
+            if (length < length_) {
+                if constexpr (!TriviallyDestructible<T>) {
+                    for (Ulen i = length_; i > length; i--) {
+                        data_[i - 1].~T();
+                    }
+                }
+            } else if (length > length_) {
+                if (!reserve(length)) {
+                    return false;
+                }
+                for (Ulen i = length_; i < length; i++) {
+                    new (data_ + i, Nat{}) T{};
+                }
+            }
+            length_ = length;
+            return true;
+	}
+
+        /// @brief Reserves memory for at least `length` elements.
+        ///
+        /// @return `true` on success, `false` if memory allocation failed.
+	Bool reserve(Ulen length) {
+            if (length <= capacity_) {
+                return true;
+            }
+            const auto min_capacity = Ulen(Array<T>::MIN_CAPACITY);
+            Ulen capacity = N < min_capacity ? min_capacity : N;
+            while (capacity < length) {
+                capacity = (capacity * Array<T>::RESIZE_FACTOR) / 100;
+            }
+
+            if constexpr (TriviallyRelocatable<T>) {
+                if (!is_inline()) {
+                    auto data = allocator_.reallocate(data_, capacity_, capacity, false);
+                    if (!data) {
+                        return false;
+                    }
+                    data_ = data;
+                    capacity_ = capacity;
+                    return true;
+                }
+            }
+
+            auto data = allocator_.allocate<T>(capacity, false);
+            if (!data) {
+                return false;
+            }
+            for (Ulen i = 0; i < length_; i++) {
+                new (data + i, Nat{}) T{move(data_[i])};
+            }
+            drop();
+            data_ = data;
+            capacity_ = capacity;
+            return true;
+	}
+
+        /// @brief Constructs an element in-place at the end of the array.
+        /// @return `true` on success, `false` on allocation failure.
+	template<typename... Ts>
+	Bool emplace_back(Ts&&... args) {
+            if (!reserve(length_ + 1)) return false;
+            new (data_ + length_, Nat{}) T{forward<Ts>(args)...};
+            length_++;
+            return true;
+	}
+
+        /// @brief Appends an element by moving it to the end.
+        /// @return `true` on success, `false` on allocation failure.
+	Bool push_back(T&& value)
+            requires MoveConstructible<T>
+	{
+            if (!reserve(length_ + 1)) return false;
+            new (data_ + length_, Nat{}) T{move(value)};
+            length_++;
+            return true;
+	}
+
+        /// @brief Appends an element by copying it to the end.
+        /// @return `true` on success, `false` on allocation failure.
+	Bool push_back(const T& value)
+            requires CopyConstructible<T>
+	{
+            if (!reserve(length_ + 1)) return false;
+            new (data_ + length_, Nat{}) T{value};
+            length_++;
+            return true;
+	}
+
+        /// @brief Creates a deep copy of the array using the provided allocator.
+        ///
+        /// Handles both copy-constructible types and types with a `copy()` method.
+        /// @return A new SmallArray wrapped in Maybe, or empty if allocation failed.
+	Maybe<SmallArray> copy(Allocator& allocator)
+            requires CopyConstructible<T> || MaybeCopyable<T>
+	{
+            // Like Array::copy, the length grows with each copied element so
+            // a failure part way destroys only the copies that were made.
+            SmallArray result{allocator};
+            if (!result.reserve(length_)) {
+                return {};
+            }
+            for (Ulen i = 0; i < length_; i++) {
+                if constexpr (CopyConstructible<T>) {
+                    new (result.data_ + i, Nat{}) T{data_[i]}; // Call the copy constructor
+                    result.length_++;
+                } else if constexpr (MaybeCopyable<T>) {
+                    auto copied = data_[i].copy(allocator);
+                    if (!copied) {
+                        return {};
+                    }
+                    new (result.data_ + i, Nat{}) T{move(*copied)};
+                    result.length_++;
+                }
+            }
+            return result;
+	}
+
+        /// @brief Removes the last element. Undefined behavior if empty.
+	void pop_back() {
+            if constexpr (!TriviallyDestructible<T>) {
+                data_[length_ - 1].~T();
+            }
+            length_--;
+	}
+
+        /// @brief Removes the first element and shifts remaining elements (O(N)).
+	void pop_front() {
+            for (Ulen i = 1; i < length_; i++) {
+                data_[i - 1] = move(data_[i]);
+            }
+            pop_back();
+	}
+
+        /// @brief Destroys all elements but keeps the allocated memory capacity.
+	void clear() {
+            destruct();
+            length_ = 0;
+	}
+
+        /// @brief Destroys all elements, releases any spilled block and goes back to inline storage.
+	void reset() {
+            drop();
+            data_ = storage();
+            length_ = 0;
+            capacity_ = N;
+	}
+
+        /// @brief Returns `true` while the elements are in the inline storage.
+	[[nodiscard]] CTL_FORCEINLINE Bool is_inline() const { return data_ == storage(); }
+
+        /// @brief Returns a pointer to the underlying data.
+	CTL_FORCEINLINE constexpr T* data() { return data_; }
+	CTL_FORCEINLINE constexpr const T* data() const { return data_; }
+
+        /// @brief Returns a reference to the last element.
+	CTL_FORCEINLINE constexpr T& last() { return data_[length_ - 1]; }
+	CTL_FORCEINLINE constexpr const T& last() const { return data_[length_ - 1]; }
+
+	[[nodiscard]] CTL_FORCEINLINE constexpr auto length() const { return length_; }
+	[[nodiscard]] CTL_FORCEINLINE constexpr auto capacity() const { return capacity_; }
+	[[nodiscard]] CTL_FORCEINLINE constexpr auto is_empty() const { return length_ == 0; }
+	[[nodiscard]] CTL_FORCEINLINE constexpr Allocator& allocator() { return allocator_; }
+	[[nodiscard]] CTL_FORCEINLINE constexpr Allocator& allocator() const { return allocator_; }
+
+        /// @brief Unchecked access to element at index.
+	[[nodiscard]] CTL_FORCEINLINE constexpr T& operator[](Ulen index) { return data_[index]; }
+	[[nodiscard]] CTL_FORCEINLINE constexpr const T& operator[](Ulen index) const { return data_[index]; }
+
+        /// @brief Returns a slice view of the entire array.
+	CTL_FORCEINLINE constexpr Slice<T> slice() { return { data_, length_ }; }
+	CTL_FORCEINLINE constexpr Slice<const T> slice() const { return { data_, length_ }; }
+
+	// Just enough to make range based for loops work
+	[[nodiscard]] CTL_FORCEINLINE constexpr T* begin() { return data_; }
+	[[nodiscard]] CTL_FORCEINLINE constexpr const T* begin() const { return data_; }
+	[[nodiscard]] CTL_FORCEINLINE constexpr T* end() { return data_ + length_; }
+	[[nodiscard]] CTL_FORCEINLINE constexpr const T* end() const { return data_ + length_; }
+
+    private:
+	CTL_FORCEINLINE T* storage() { return reinterpret_cast<T*>(inline_); }
+	CTL_FORCEINLINE const T* storage() const { return reinterpret_cast<const T*>(inline_); }
+
+        /// @brief Helper to call destructors on all active elements.
+	void destruct() {
+            if constexpr (!TriviallyDestructible<T>) {
+                for (Ulen i = length_; i > 0; i--) {
+                    data_[i - 1].~T();
+                }
+            }
+	}
+
+	SmallArray* drop() {
+            destruct();
+            if (!is_inline()) {
+                allocator_.deallocate(data_, capacity_);
+            }
+            return this;
+	}
+
+	T*         data_;
+	Ulen       length_   = 0;
+	Ulen       capacity_ = N;
+	Allocator& allocator_;
+	alignas(T) Uint8 inline_[sizeof(T) * N];
+    };
+
+} // namespace ctl
+
+#endif // CTL_SMALL_ARRAY_HPP
@@ -20,6 +20,14 @@ namespace ctl {
         /// @brief Returns the current position in the stream.
         /// @return The byte offset from the beginning.
 	virtual Uint64 tell() const = 0;
+
+        /// @brief Returns the next `len` bytes in place and skips past them.
+        ///
+        /// Lets loaders point at the stream's memory instead of copying out of it.
+        /// The bytes stay valid as long as the stream does.
+        /// @return The bytes, or nullptr (nothing consumed) if the stream is not
+        /// memory backed or has fewer than `len` bytes left.
+	virtual Uint8* map(Ulen) { return nullptr; }
     };
 
     /// @brief A concrete Stream implementation backed by a filesystem file.
@@ -52,6 +60,41 @@ namespace ctl {
 	Uint64 offset_ = 0;
     };
 
+    /// @brief A read-only Stream over a private copy-on-write mapping of a file.
+    ///
+    /// `map` hands out pointers into the mapping, so `Pool::load` and `Slab::load`
+    /// use the snapshot memory in place and pages are only read from disk when
+    /// first touched. Writes through those pointers stay private to the process.
+    /// Everything loaded from the stream must be destroyed before it is closed.
+    struct MappedStream : Stream {
+	MappedStream(MappedStream&& other)
+            : Stream{move(other)}
+            , data_{exchange(other.data_, Slice<Uint8>{})}
+            , offset_{exchange(other.offset_, 0)}
+	{}
+
+	~MappedStream() { close(); }
+
+        /// @brief Maps a file for reading.
+        /// @return A stream over the mapping, or empty if the file cannot be opened
+        /// or the platform cannot map files.
+	static Maybe<MappedStream> open(StringView name);
+
+        /// @brief Unmaps the file.
+	void close();
+
+	virtual Ulen write(Slice<const Uint8> data);
+	virtual Ulen read(Slice<Uint8> data);
+	virtual Uint64 tell() const;
+	virtual Uint8* map(Ulen len);
+    private:
+	MappedStream(Slice<Uint8> data)
+            : data_{data}
+	{}
+	Slice<Uint8> data_;
+	Ulen         offset_ = 0;
+    };
+
 } // namespace ctl
 
 #endif // CTL_STREAM_HPP
@@ -35,6 +35,14 @@ namespace ctl {
         /// @brief Returns the total size of the file.
 	static Uint64 tell_file(File* file);
 
+        /// @brief Maps the first `len` bytes of a file as private copy-on-write memory.
+        ///
+        /// Pages are read from the file on first touch, writes go to private copies
+        /// and never reach the file.
+        /// @return The mapping, or nullptr where the platform cannot map files.
+	static void* map_file(File* file, Uint64 len);
+	static void unmap_file(void* addr, Uint64 len);
+
 	Directory* open_dir(StringView name);
 	void close_dir(Directory*);
 
@@ -47,6 +55,50 @@ namespace ctl {
     struct Heap {
 	static void *allocate(Ulen len, Bool zero);
 	static void deallocate(void* addr, Ulen len);
+
+        /// @brief Resizes a block returned by `allocate` without copying its contents.
+        ///
+        /// Shrinking keeps the address and hands the tail pages back to the OS where
+        /// the platform allows it. Growing may remap the block to a new address.
+        /// @param zero If true, the grown range is zero-initialized.
+        /// @return The new address, or nullptr if the block could not be resized (it
+        /// is then left untouched).
+	static void* resize(void* addr, Ulen old_len, Ulen new_len, Bool zero);
+
+        /// @brief Size of a huge page, the granularity of the `_huge` functions.
+	static inline constexpr const Ulen HUGE_PAGE_SIZE = 2 << 20;
+
+        /// @brief Allocates a block backed by huge pages where the platform allows it.
+        ///
+        /// The length is rounded up to HUGE_PAGE_SIZE. Uses explicit huge pages when
+        /// the OS has a pool of them, otherwise a HUGE_PAGE_SIZE aligned mapping
+        /// flagged for transparent huge pages, otherwise regular pages.
+        /// @return The address, or nullptr on failure. Release with `deallocate_huge`.
+	static void* allocate_huge(Ulen len, Bool zero);
+	static void deallocate_huge(void* addr, Ulen len);
+
+        /// @brief Like `resize` for blocks from `allocate_huge`.
+        ///
+        /// Shrinking releases whole huge pages at the tail. Growing only succeeds
+        /// while the length stays within the huge pages already mapped.
+	static void* resize_huge(void* addr, Ulen old_len, Ulen new_len, Bool zero);
+
+        /// @brief Returns the granularity of `commit` and `decommit` in bytes.
+	static Ulen page_size();
+
+        /// @brief Reserves `len` bytes of address space with no memory behind them.
+        /// @return The base of the reservation, or nullptr if unsupported or exhausted.
+	static void* reserve(Ulen len);
+
+        /// @brief Backs a page aligned range of a reservation with zeroed read-write memory.
+	static Bool commit(void* addr, Ulen len);
+
+        /// @brief Hands the pages of a committed range back to the OS. The range stays
+        /// reserved and reads as zero once committed again.
+	static void decommit(void* addr, Ulen len);
+
+        /// @brief Releases a whole reservation made by `reserve`.
+	static void release(void* addr, Ulen len);
     };
 
     /// @brief Standard output interaction.
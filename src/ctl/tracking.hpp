@@ -0,0 +1,111 @@
+#ifndef CTL_TRACKING_HPP
+#define CTL_TRACKING_HPP
+#include "allocator.hpp"
+#include "atomic.hpp"
+#include "string.hpp"
+
+namespace ctl {
+
+    /// @brief A snapshot of the counters of a TrackingAllocator.
+    struct AllocatorStats {
+        /// @brief Number of log2 size buckets. Bucket N counts requests of (2^(N-1), 2^N] bytes.
+	static inline constexpr const Ulen BUCKETS = 48;
+
+	Uint64 allocs         = 0; ///< Successful `alloc` calls.
+	Uint64 frees          = 0; ///< `free` calls (null addresses excluded).
+	Uint64 grows_in_place = 0; ///< `grow` calls that kept the address.
+	Uint64 grows_moved    = 0; ///< `grow` calls that returned a new address.
+	Uint64 shrinks        = 0; ///< `shrink` calls.
+	Uint64 failures       = 0; ///< `alloc` or `grow` calls that returned 0.
+	Sint64 bytes_live     = 0; ///< Bytes currently allocated.
+	Sint64 bytes_peak     = 0; ///< High-water mark of `bytes_live`.
+	Uint64 histogram[BUCKETS] = {}; ///< `alloc` calls by log2 of the requested size.
+
+        /// @brief Returns the histogram bucket of a request of `len` bytes.
+	static constexpr Ulen bucket(Ulen len) {
+            Ulen b = 0;
+            while (b + 1 < BUCKETS && (Ulen(1) << b) < len) b++;
+            return b;
+	}
+
+        /// @brief Appends a human readable report to `builder`.
+	void dump(StringView name, StringBuilder& builder) const;
+    };
+
+    /// @brief An allocator wrapper that counts what goes through it.
+    ///
+    /// Forwards every call to the wrapped allocator and records counts, live bytes,
+    /// the high-water mark, in-place versus moving grows and a log2 histogram of
+    /// request sizes. Counters live in per-thread shards (threads are spread over
+    /// SHARDS cache-line aligned slots) and are merged when `stats()` is called, so
+    /// it is cheap enough to leave on. Live bytes are folded into a shared total
+    /// once a shard has accumulated FLUSH bytes of change. Each shard keeps the
+    /// high-water mark of the shared total plus its own pending bytes and
+    /// `stats()` takes the largest. A single thread's peak is exact, with several
+    /// threads `bytes_peak` may miss a peak by the bytes still pending in the
+    /// other shards, at most (SHARDS - 1) * FLUSH.
+    struct TrackingAllocator : Allocator {
+	static inline constexpr const Ulen   SHARDS = 16;
+	static inline constexpr const Sint64 FLUSH  = 64 << 10;
+
+        /// @brief Tracks allocations made through `allocator`.
+        /// @param name Label used in reports.
+	constexpr TrackingAllocator(Allocator& allocator, StringView name = "allocator")
+            : allocator_{allocator}
+            , name_{name}
+	{}
+
+	TrackingAllocator(const TrackingAllocator&) = delete;
+	TrackingAllocator(TrackingAllocator&&) = delete;
+
+        /// @brief Merges the per-thread shards into a snapshot.
+	AllocatorStats stats() const;
+
+        /// @brief Appends a report of the current counters to `builder`.
+	void report(StringBuilder& builder) const;
+
+        /// @brief Prints a report of the current counters through `Console::print`.
+	void print() const;
+
+	virtual Address alloc(Ulen new_len, Bool zero);
+	virtual void free(Address addr, Ulen old_len);
+	virtual void shrink(Address addr, Ulen old_len, Ulen new_len);
+	virtual Address grow(Address addr, Ulen old_len, Ulen new_len, Bool zero);
+	virtual Address alloc_aligned(Ulen new_len, Ulen align, Bool zero);
+	virtual void free_aligned(Address addr, Ulen old_len, Ulen align);
+	virtual Address grow_aligned(Address addr, Ulen old_len, Ulen new_len, Ulen align, Bool zero);
+
+	[[nodiscard]] CTL_FORCEINLINE constexpr Allocator& allocator() const { return allocator_; }
+	[[nodiscard]] CTL_FORCEINLINE constexpr StringView name() const { return name_; }
+
+    private:
+	struct alignas(64) Shard {
+            Atomic<Uint64> allocs;
+            Atomic<Uint64> frees;
+            Atomic<Uint64> grows_in_place;
+            Atomic<Uint64> grows_moved;
+            Atomic<Uint64> shrinks;
+            Atomic<Uint64> failures;
+            Atomic<Sint64> pending; // Live bytes not yet folded into live_
+            Atomic<Sint64> peak;    // Highest live_ + pending seen by this shard
+            Atomic<Uint64> histogram[AllocatorStats::BUCKETS];
+	};
+
+	Shard& shard();
+	void account(Shard& shard, Sint64 delta);
+
+	// Record the outcome of a forwarded call.
+	Address allocated(Address addr, Ulen new_len);
+	void freed(Ulen old_len);
+	Address grown(Address old_addr, Address new_addr, Ulen old_len, Ulen new_len);
+
+	Allocator&     allocator_;
+	StringView     name_;
+	Atomic<Sint64> live_;
+	Atomic<Sint64> peak_;
+	Shard          shards_[SHARDS];
+    };
+
+} // namespace ctl
+
+#endif // CTL_TRACKING_HPP
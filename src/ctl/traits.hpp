@@ -84,6 +84,21 @@ namespace ctl {
     template<typename T>
     concept TriviallyDestructible = is_trivially_destructible<T>;
 
+    template<typename T>
+    inline constexpr bool is_trivially_copyable = __is_trivially_copyable(T);
+
+    /// @brief Whether an object of T may be moved to a new address by copying its
+    /// bytes, the source then being treated as destroyed without running `~T()`.
+    ///
+    /// True for trivially copyable types. Types that own resources but hold no
+    /// pointers into themselves (e.g. `Array<T>`) opt in by specializing this.
+    template<typename T>
+    inline constexpr bool is_trivially_relocatable = is_trivially_copyable<T>;
+
+    /// @brief Concept ensuring T can be relocated with a plain memory copy.
+    template<typename T>
+    concept TriviallyRelocatable = is_trivially_relocatable<T>;
+
     /// @brief Utility to obtain a reference to T in unevaluated contexts.
     template<typename T> AddLValueReference<T> declval();
 
@@ -62,4 +62,21 @@ namespace ctl {
 	return result;
     }
 
+    Slice<Uint8> File::map_private() const {
+	const auto len = tell();
+	if (len == 0) {
+            return {};
+	}
+	if (auto addr = Filesystem::map_file(file_, len)) {
+            return { static_cast<Uint8*>(addr), Ulen(len) };
+	}
+	return {};
+    }
+
+    void File::unmap(Slice<Uint8> mapping) {
+	if (!mapping.is_empty()) {
+            Filesystem::unmap_file(mapping.data(), mapping.length());
+	}
+    }
+
 } // namespace ctl
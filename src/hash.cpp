@@ -0,0 +1,38 @@
+#include "ctl/hash.hpp"
+
+namespace ctl {
+
+    // Assembled from bytes so any alignment works, compilers turn this into a
+    // single load.
+    static CTL_FORCEINLINE Uint64 load64(const Uint8* bytes, Ulen length) {
+        Uint64 value = 0;
+        for (Ulen i = 0; i < length; i++) {
+            value |= Uint64(bytes[i]) << (i * 8);
+        }
+        return value;
+    }
+
+    static CTL_FORCEINLINE Uint64 absorb(Uint64 h, Uint64 word) {
+        h ^= word * 0xbf58476d1ce4e5b9_u64;
+        return ((h << 31) | (h >> 33)) * 0x9e3779b97f4a7c15_u64;
+    }
+
+    Hash hash_bytes(const void* data, Ulen length, Hash seed) {
+        auto bytes = static_cast<const Uint8*>(data);
+        Uint64 h = seed ^ (Uint64(length) * 0x9e3779b97f4a7c15_u64);
+        for (; length >= 8; bytes += 8, length -= 8) {
+            h = absorb(h, load64(bytes, 8));
+        }
+        if (length) {
+            h = absorb(h, load64(bytes, length));
+        }
+        // The splitmix64 finalizer, every input bit reaches every output bit.
+        h ^= h >> 30;
+        h *= 0xbf58476d1ce4e5b9_u64;
+        h ^= h >> 27;
+        h *= 0x94d049bb133111eb_u64;
+        h ^= h >> 31;
+        return h;
+    }
+
+} // namespace ctl
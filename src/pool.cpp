@@ -1,4 +1,5 @@
 #include "ctl/pool.hpp"
+#include "ctl/array.hpp"
 #include "ctl/slice.hpp"
 #include "ctl/stream.hpp"
 
@@ -12,19 +13,44 @@ namespace ctl {
 	Uint64 size;
 	Uint64 capacity;
     };
-    // Following the header:
-    // 	Uint32 used[PoolHeader::capacity / BITS]
+    // Following the header, version 1 (Format::DENSE):
+    // 	Uint64 used[PoolHeader::capacity / BITS]
     // 	Uint8  data[PoolHeader::size * PoolHeader::capacity]
+    //
+    // Version 2 (Format::SPARSE) only stores the live slots, as runs of
+    // consecutive set bits of used:
+    // 	Uint64  n_runs
+    // 	PoolRun runs[n_runs]
+    // 	Uint8   data[PoolHeader::size * PoolHeader::length]
+    //
+    // Runs are in slot order and data holds the objects of every run back to
+    // back, so the counts add up to PoolHeader::length.
     static_assert(sizeof(PoolHeader) == 32);
 
+    struct PoolRun {
+	Uint32 start;
+	Uint32 count;
+    };
+    static_assert(sizeof(PoolRun) == 8);
+
+    // Size of the buffer that gathers (or scatters) the objects of short runs
+    // so a sparse pool is not written with one Stream call per run.
+    static inline constexpr const Ulen STAGING = 64 << 10;
+
     Maybe<Pool> Pool::create(Allocator& allocator, Ulen size, Ulen capacity) {
+	if (Uint64(capacity) > MAX_CAPACITY) {
+            return {};
+	}
 	// Ensure capacity is a multiple of BITS
 	capacity = ((capacity + (BITS - 1)) / BITS) * BITS;
 	auto data = allocator.allocate<Uint8>(size * capacity, true);
 	if (!data) {
             return {};
 	}
-	auto used = allocator.allocate<Word>(capacity / BITS, true);
+	Ulen offsets[MAX_LEVELS];
+	Uint32 levels = 0;
+	const auto n_words = layout(capacity / BITS, offsets, levels);
+	auto used = allocator.allocate<Word>(n_words, true);
 	if (!used) {
             allocator.deallocate(data, size * capacity);
             return {};
@@ -35,10 +61,58 @@ namespace ctl {
             0_ulen,
             capacity,
             data,
-            used
+            used,
+            used + capacity / BITS,
+            Storage::OWNED
 	};
     }
 
+    Maybe<Pool> Pool::create(Allocator& allocator, Ulen size, Ulen capacity, Uint8* data) {
+	if (Uint64(capacity) > MAX_CAPACITY) {
+            return {};
+	}
+	capacity = ((capacity + (BITS - 1)) / BITS) * BITS;
+	Ulen offsets[MAX_LEVELS];
+	Uint32 levels = 0;
+	const auto n_words = layout(capacity / BITS, offsets, levels);
+	auto used = allocator.allocate<Word>(n_words, true);
+	if (!used) {
+            return {};
+	}
+	return Pool {
+            allocator,
+            size,
+            0_ulen,
+            capacity,
+            data,
+            used,
+            used + capacity / BITS,
+            Storage::BORROWED
+	};
+    }
+
+    Bool Pool::relocate(Uint8* data) {
+	const auto n_words = capacity_ / BITS;
+	if (storage_ == Storage::MAPPED) {
+            auto used = allocator_.allocate<Word>(words_, false);
+            if (!used) {
+                return false;
+            }
+            Allocator::memcopy(Address(used), Address(used_), n_words * sizeof(Word));
+            allocator_.deallocate(tree_, words_ - n_words);
+            used_ = used;
+            tree_ = used + n_words;
+            summarize();
+	}
+	Allocator::memcopy(Address(data), Address(data_), size_ * capacity_);
+	if (storage_ == Storage::OWNED) {
+            allocator_.deallocate(data_, size_ * capacity_);
+	}
+	data_ = data;
+	storage_ = Storage::BORROWED;
+	return true;
+    }
+
     Maybe<Pool> Pool::load(Allocator& allocator, Stream& stream) {
 	PoolHeader header;
 	if (stream.read(Slice{&header, 1}.cast<Uint8>()) != sizeof(header)) {
@@ -47,22 +121,74 @@ namespace ctl {
 	if (Slice<const Uint8>{header.magic} != Slice{"pool"}.cast<const Uint8>()) {
             return {};
 	}
-	if (header.version != 1) {
+	if (header.version == Uint32(Format::SPARSE)) {
+            return load_sparse(allocator, stream, header);
+	}
+	if (header.version != Uint32(Format::DENSE)) {
+            return {};
+	}
+	// layout() only has room for the levels of a valid capacity.
+	if (header.capacity % BITS != 0 || header.capacity > MAX_CAPACITY) {
             return {};
 	}
 	const auto n_words = static_cast<Ulen>(header.capacity / BITS);
 	const auto n_bytes = static_cast<Ulen>(header.size * header.capacity);
-	auto used = allocator.allocate<Word>(n_words, false);
+	// Room for the summary levels after the used bitset, rebuilt by the constructor.
+	Ulen offsets[MAX_LEVELS];
+	Uint32 levels = 0;
+	const auto n_total = layout(n_words, offsets, levels);
+	const auto n_mapped = n_words * sizeof(Word) + n_bytes;
+	if (auto mapped = stream.map(n_mapped)) {
+            // Use the snapshot in place when it is aligned like our own allocations.
+            const auto data = mapped + n_words * sizeof(Word);
+            if (Address(mapped) % alignof(Word) == 0 && Address(data) % Allocator::ALIGNMENT == 0) {
+                auto tree = allocator.allocate<Word>(n_total - n_words, false);
+                if (!tree) {
+                    return {};
+                }
+                return Pool {
+                    allocator,
+                    Ulen(header.size),
+                    Ulen(header.length),
+                    Ulen(header.capacity),
+                    data,
+                    reinterpret_cast<Word*>(mapped),
+                    tree,
+                    Storage::MAPPED
+                };
+            }
+            // Misaligned, copy out of the mapping like a read would.
+            auto used = allocator.allocate<Word>(n_total, false);
+            auto copy = allocator.allocate<Uint8>(n_bytes, false);
+            if (!used || !copy) {
+                allocator.deallocate(used, n_total);
+                allocator.deallocate(copy, n_bytes);
+                return {};
+            }
+            Allocator::memcopy(Address(used), Address(mapped), n_words * sizeof(Word));
+            Allocator::memcopy(Address(copy), Address(data), n_bytes);
+            return Pool {
+                allocator,
+                Ulen(header.size),
+                Ulen(header.length),
+                Ulen(header.capacity),
+                copy,
+                used,
+                used + n_words,
+                Storage::OWNED
+            };
+	}
+	auto used = allocator.allocate<Word>(n_total, false);
 	auto data = allocator.allocate<Uint8>(n_bytes, false);
 	if (!used || !data) {
-            allocator.deallocate(used, n_words);
+            allocator.deallocate(used, n_total);
             allocator.deallocate(data, n_bytes);
             return {};
 	}
 	if (stream.read(Slice{used, n_words}.cast<Uint8>()) != (n_words * sizeof(Word)) ||
 	    stream.read(Slice{data, n_bytes}.cast<Uint8>()) != (n_bytes * sizeof(Uint8)))
             {
-		allocator.deallocate(used, n_words);
+		allocator.deallocate(used, n_total);
 		allocator.deallocate(data, n_bytes);
 		return {};
             }
@@ -72,14 +198,122 @@ namespace ctl {
             Ulen(header.length),
             Ulen(header.capacity),
             data,
-            used
+            used,
+            used + n_words,
+            Storage::OWNED
+	};
+    }
+
+    Maybe<Pool> Pool::load_sparse(Allocator& allocator, Stream& stream, const PoolHeader& header) {
+	if (header.capacity % BITS != 0 || header.capacity > MAX_CAPACITY) {
+            return {};
+	}
+	const auto size = static_cast<Ulen>(header.size);
+	const auto capacity = static_cast<Ulen>(header.capacity);
+	const auto length = static_cast<Ulen>(header.length);
+	if (length > capacity) {
+            return {};
+	}
+	Uint64 n_runs = 0;
+	if (stream.read(Slice{&n_runs, 1}.cast<Uint8>()) != sizeof(n_runs) || n_runs > length) {
+            return {};
+	}
+	ScratchAllocator<4096> scratch{allocator};
+	auto runs = scratch.allocate<PoolRun>(Ulen(n_runs), false);
+	auto staging = scratch.allocate<Uint8>(STAGING, false);
+	if (!runs || !staging) {
+            return {};
+	}
+	const auto runs_bytes = Ulen(n_runs) * sizeof(PoolRun);
+	if (stream.read(Slice{runs, Ulen(n_runs)}.cast<Uint8>()) != runs_bytes) {
+            return {};
+	}
+	// Runs must be in order, in range and add up to the length.
+	Ulen total = 0;
+	Ulen end = 0;
+	for (Ulen i = 0; i < n_runs; i++) {
+            const auto& run = runs[i];
+            if (run.count == 0 || run.start < end || Ulen(run.start) + run.count > capacity) {
+                return {};
+            }
+            end = Ulen(run.start) + run.count;
+            total += run.count;
+	}
+	if (total != length) {
+            return {};
+	}
+
+	const auto n_words = capacity / BITS;
+	const auto n_bytes = size * capacity;
+	Ulen offsets[MAX_LEVELS];
+	Uint32 levels = 0;
+	const auto n_total = layout(n_words, offsets, levels);
+	auto used = allocator.allocate<Word>(n_total, true);
+	auto data = allocator.allocate<Uint8>(n_bytes, true);
+	if (!used || !data) {
+            allocator.deallocate(used, n_total);
+            allocator.deallocate(data, n_bytes);
+            return {};
+	}
+
+	// Scatter the objects. Long runs are read straight into place, short ones
+	// come out of the staging buffer, which never reads past this pool.
+	auto remaining = size * length;
+	Ulen pos = 0;
+	Ulen avail = 0;
+	for (Ulen i = 0; i < n_runs; i++) {
+            const auto& run = runs[i];
+            for (Ulen slot = run.start; slot < Ulen(run.start) + run.count; slot++) {
+                used[slot / BITS] |= Word(1) << (slot % BITS);
+            }
+            auto dst = data + size * run.start;
+            auto len = size * run.count;
+            while (len) {
+                if (pos == avail) {
+                    if (len >= STAGING) {
+                        if (stream.read(Slice{dst, len}) != len) {
+                            break;
+                        }
+                        remaining -= len;
+                        len = 0;
+                        break;
+                    }
+                    const auto want = remaining < STAGING ? remaining : STAGING;
+                    avail = stream.read(Slice{staging, want});
+                    pos = 0;
+                    if (avail != want) {
+                        break;
+                    }
+                    remaining -= avail;
+                }
+                const auto n = len < avail - pos ? len : avail - pos;
+                Allocator::memcopy(Address(dst), Address(staging + pos), n);
+                dst += n;
+                pos += n;
+                len -= n;
+            }
+            if (len) {
+                allocator.deallocate(used, n_total);
+                allocator.deallocate(data, n_bytes);
+                return {};
+            }
+	}
+	return Pool {
+            allocator,
+            size,
+            length,
+            capacity,
+            data,
+            used,
+            used + n_words,
+            Storage::OWNED
 	};
     }
 
-    Bool Pool::save(Stream& stream) const {
+    Bool Pool::save(Stream& stream, Format format) const {
 	PoolHeader header = {
             .magic    = { 'p', 'o', 'o', 'l' },
-            .version  = Uint64(1),
+            .version  = Uint32(format),
             .length   = Uint64(length_),
             .size     = Uint64(size_),
             .capacity = Uint64(capacity_),
@@ -87,7 +321,11 @@ namespace ctl {
 
         auto h_slice = Slice{&header, 1}.cast<const Uint8>();
         if (stream.write(h_slice) != h_slice.length()) return false;
-        
+
+	if (format == Format::SPARSE) {
+            return save_sparse(stream);
+	}
+
         auto u_slice = Slice{used_, capacity_ / BITS}.cast<const Uint8>();
         if (stream.write(u_slice) != u_slice.length()) return false;
         
@@ -97,6 +335,63 @@ namespace ctl {
         return true;
     }
 
+    Bool Pool::save_sparse(Stream& stream) const {
+	ScratchAllocator<4096> scratch{allocator_};
+	Array<PoolRun> runs{scratch};
+	for (Ulen w_index = 0; w_index < capacity_ / BITS; w_index++) {
+            // Peel runs of ones off the word, joining the one left open by the
+            // previous word.
+            auto bits = used_[w_index];
+            Uint32 offset = 0;
+            while (bits) {
+                const auto skip = count_trailing_zeros(bits);
+                bits >>= skip;
+                offset += skip;
+                const auto ones = ~bits == 0 ? BITS : count_trailing_zeros(~bits);
+                const auto start = Uint32(w_index * BITS + offset);
+                if (!runs.is_empty() && runs.last().start + runs.last().count == start) {
+                    runs.last().count += ones;
+                } else if (!runs.push_back(PoolRun { start, ones })) {
+                    return false;
+                }
+                bits = ones == BITS ? 0 : bits >> ones;
+                offset += ones;
+            }
+	}
+
+	const Uint64 n_runs = runs.length();
+	auto n_slice = Slice{&n_runs, 1}.cast<const Uint8>();
+	if (stream.write(n_slice) != n_slice.length()) return false;
+	auto r_slice = runs.slice().cast<const Uint8>();
+	if (stream.write(r_slice) != r_slice.length()) return false;
+
+	// Gather short runs in the staging buffer, write long ones directly.
+	auto staging = scratch.allocate<Uint8>(STAGING, false);
+	if (!staging) {
+            return false;
+	}
+	Ulen fill = 0;
+	auto flush = [&]() {
+            const auto ok = stream.write(Slice<const Uint8>{staging, fill}) == fill;
+            fill = 0;
+            return ok;
+	};
+	for (const auto& run : runs) {
+            const auto src = data_ + size_ * run.start;
+            const auto len = size_ * run.count;
+            if (fill + len > STAGING && !flush()) {
+                return false;
+            }
+            if (len >= STAGING) {
+                if (stream.write(Slice<const Uint8>{src, len}) != len) return false;
+                continue;
+            }
+            Allocator::memcopy(Address(staging + fill), Address(src), len);
+            fill += len;
+	}
+	return flush();
+    }
+
     Pool::Pool(Pool&& other)
 	: allocator_{other.allocator_}
 	, size_{exchange(other.size_, 0)}
@@ -104,54 +399,238 @@ namespace ctl {
 	, capacity_{exchange(other.capacity_, 0)}
 	, data_{exchange(other.data_, nullptr)}
 	, used_{exchange(other.used_, nullptr)}
+	, tree_{exchange(other.tree_, nullptr)}
 	, last_{exchange(other.last_, 0)}
-    {}
+	, storage_{exchange(other.storage_, Storage::OWNED)}
+	, levels_{exchange(other.levels_, 0)}
+	, words_{exchange(other.words_, 0)}
+    {
+	for (Uint32 i = 0; i < levels_; i++) {
+            summary_[i] = other.summary_[i];
+	}
+    }
 
-#if defined(CTL_COMPILER_MSVC)
+    void Pool::summarize() {
+	for (Ulen i = 0; i < words_ - capacity_ / BITS; i++) {
+            tree_[i] = 0;
+	}
+	// Level 1 marks words of used_ with a free slot, every level above marks
+	// the non-zero words of the level below.
+	auto below = used_;
+	auto n_below = capacity_ / BITS;
+	for (Uint32 level = 0; level < levels_; level++) {
+            const auto words = summary(level);
+            for (Ulen i = 0; i < n_below; i++) {
+                const auto has_free = level == 0 ? ~below[i] != 0 : below[i] != 0;
+                if (has_free) {
+                    words[i / BITS] |= Word(1) << (i % BITS);
+                }
+            }
+            below = words;
+            n_below = (n_below + BITS - 1) / BITS;
+	}
+    }
 
-    typedef unsigned long DWORD;
+    Maybe<Uint32> Pool::find() {
+	if (~used_[last_] != 0) {
+            return Uint32 { last_ };
+	}
+	// Descend from the top summary word to a word with a free slot.
+	Ulen index = 0;
+	for (Uint32 level = levels_; level > 0; level--) {
+            const auto word = summary(level - 1)[index];
+            if (word == 0) {
+                return {}; // Out of memory.
+            }
+            index = index * BITS + count_trailing_zeros(word);
+	}
+	last_ = Uint32(index);
+	return Uint32 { last_ };
+    }
 
-    // Count the number of trailing zero bits in [value] which is the same as
-    // giving the index to the first non-zero bit.
-    static inline Uint32 count_trailing_zeros(Uint64 value) {
-        DWORD trailing_zero = 0;
-        if (_BitScanForward64(&trailing_zero, value)) {
-            return trailing_zero;
-        }
-        return 64;
+    void Pool::claim(Uint32 w_index, Word bits) {
+	used_[w_index] |= bits;
+	length_ += count_set_bits(bits);
+	if (~used_[w_index] == 0) {
+            // The word filled up, clear its bit and every bit above that now
+            // covers only full words.
+            Ulen index = w_index;
+            for (Uint32 level = 0; level < levels_; level++) {
+                auto& word = summary(level)[index / BITS];
+                word &= ~(Word(1) << (index % BITS));
+                if (word != 0) {
+                    break;
+                }
+                index /= BITS;
+            }
+	}
     }
-#else
-    static inline Uint32 count_trailing_zeros(Uint64 value) {
-        return __builtin_ctzll(value);
+
+    void Pool::release(Uint32 w_index, Word bits) {
+	const auto was_full = ~used_[w_index] == 0;
+	used_[w_index] &= ~bits;
+	length_ -= count_set_bits(bits);
+	if (was_full) {
+            // Set the bits up to the first level that already had a free slot.
+            Ulen index = w_index;
+            for (Uint32 level = 0; level < levels_; level++) {
+                auto& word = summary(level)[index / BITS];
+                const auto had_free = word != 0;
+                word |= Word(1) << (index % BITS);
+                if (had_free) {
+                    break;
+                }
+                index /= BITS;
+            }
+	}
     }
-#endif
 
     Maybe<PoolRef> Pool::allocate() {
-	const auto n_words = Uint32(capacity_ / BITS);
-	const auto w_index = last_;
-	if (auto scan = ~used_[w_index]) {
-            auto b_index = count_trailing_zeros(scan);
-            used_[w_index] |= Word(1) << b_index;
-            length_++;
-            return PoolRef { w_index * BITS + b_index };
+	const auto w_index = find();
+	if (!w_index) {
+            return {};
+	}
+	const auto b_index = count_trailing_zeros(~used_[*w_index]);
+	claim(*w_index, Word(1) << b_index);
+	return PoolRef { *w_index * BITS + b_index };
+    }
+
+    void Pool::deallocate(PoolRef ref) {
+	release(ref.index / BITS, Word(1) << (ref.index % BITS));
+    }
+
+    Ulen Pool::allocate_n(Slice<PoolRef> refs) {
+	Ulen n = 0;
+	while (n < refs.length()) {
+            const auto w_index = find();
+            if (!w_index) {
+                break;
+            }
+            // Take every free slot of the word, or the lowest ones still needed.
+            auto bits = ~used_[*w_index];
+            if (const auto want = refs.length() - n; count_set_bits(bits) > want) {
+                auto rest = bits;
+                for (Ulen i = 0; i < want; i++) {
+                    rest &= rest - 1;
+                }
+                bits &= ~rest;
+            }
+            claim(*w_index, bits);
+            for (auto todo = bits; todo; todo &= todo - 1) {
+                refs[n++] = PoolRef { *w_index * BITS + count_trailing_zeros(todo) };
+            }
 	}
-	for (Uint32 w_index = n_words - 1; w_index < n_words; w_index--) {
-            if (auto scan = ~used_[w_index]) {
-                auto b_index = count_trailing_zeros(scan);
-                used_[w_index] |= Word(1) << b_index;
-                length_++;
-                last_ = w_index;
-                return PoolRef { w_index * BITS + b_index };
+	return n;
+    }
+
+    void Pool::deallocate_n(Slice<const PoolRef> refs) {
+	Ulen i = 0;
+	while (i < refs.length()) {
+            // Gather the run of refs that share a word.
+            const auto w_index = refs[i].index / BITS;
+            Word bits = 0;
+            for (; i < refs.length() && refs[i].index / BITS == w_index; i++) {
+                bits |= Word(1) << (refs[i].index % BITS);
             }
+            release(w_index, bits);
 	}
-	return {}; // Out of memory.
     }
 
-    void Pool::deallocate(PoolRef ref) {
+    Maybe<ConcurrentPool> ConcurrentPool::create(Allocator& allocator, Ulen size, Ulen capacity) {
+	// Ensure capacity is a multiple of BITS
+	capacity = ((capacity + (BITS - 1)) / BITS) * BITS;
+	auto data = allocator.allocate<Uint8>(size * capacity, true);
+	if (!data) {
+            return {};
+	}
+	auto used = allocator.allocate<Atomic<Word>>(capacity / BITS, true);
+	if (!used) {
+            allocator.deallocate(data, size * capacity);
+            return {};
+	}
+	return ConcurrentPool {
+            allocator,
+            size,
+            capacity,
+            data,
+            used
+	};
+    }
+
+    ConcurrentPool::ConcurrentPool(Allocator& allocator, Ulen size, Ulen capacity, Uint8* data, Atomic<Word>* used)
+	: allocator_{allocator}
+	, size_{size}
+	, capacity_{capacity}
+	, data_{data}
+	, used_{used}
+    {
+	// Slot N starts at its bit-reversed position so the first few threads are
+	// already far apart: slot 0 at the start, slot 1 half way, slots 2 and 3
+	// at a quarter and three quarters, and so on.
+	const auto n_words = capacity_ / BITS;
+	for (Uint32 i = 0; i < HINTS; i++) {
+            Uint32 reversed = 0;
+            for (Uint32 bit = 1; bit < HINTS; bit <<= 1) {
+                reversed = (reversed << 1) | ((i & bit) ? 1 : 0);
+            }
+            hints_[i].store(Uint32(reversed * n_words / HINTS), MemoryOrder::RELAXED);
+	}
+    }
+
+    ConcurrentPool::ConcurrentPool(ConcurrentPool&& other)
+	: allocator_{other.allocator_}
+	, size_{exchange(other.size_, 0)}
+	, capacity_{exchange(other.capacity_, 0)}
+	, data_{exchange(other.data_, nullptr)}
+	, used_{exchange(other.used_, nullptr)}
+	, length_{other.length_.exchange(0, MemoryOrder::RELAXED)}
+    {
+	for (Uint32 i = 0; i < HINTS; i++) {
+            hints_[i].store(other.hints_[i].load(MemoryOrder::RELAXED), MemoryOrder::RELAXED);
+	}
+    }
+
+    // Threads are handed hint slots round-robin on their first allocation.
+    static constinit Atomic<Uint32> g_next_hint;
+    static thread_local constinit Uint32 t_hint = ~0_u32;
+
+    Maybe<PoolRef> ConcurrentPool::allocate() {
+	// Reserve a slot first. Once the reservation holds there is a free bit
+	// somewhere, even if other threads keep taking the ones we find.
+	if (length_.fetch_add(1, MemoryOrder::RELAXED) >= capacity_) {
+            length_.fetch_sub(1, MemoryOrder::RELAXED);
+            return {}; // Out of memory.
+	}
+	if (t_hint == ~0_u32) {
+            t_hint = g_next_hint.fetch_add(1, MemoryOrder::RELAXED);
+	}
+	auto& hint = hints_[t_hint % HINTS];
+	const auto n_words = Uint32(capacity_ / BITS);
+	auto w_index = hint.load(MemoryOrder::RELAXED);
+	for (;;) {
+            auto word = used_[w_index].load(MemoryOrder::RELAXED);
+            while (~word != 0) {
+                const auto bit = Word(1) << count_trailing_zeros(~word);
+                // Acquire pairs with the release in deallocate() so the previous
+                // owner's writes to the slot are visible.
+                word = used_[w_index].fetch_or(bit, MemoryOrder::ACQUIRE);
+                if ((word & bit) == 0) {
+                    hint.store(w_index, MemoryOrder::RELAXED);
+                    return PoolRef { w_index * BITS + count_trailing_zeros(bit) };
+                }
+                // Lost the race for this bit, `word` is the fresh value.
+            }
+            if (++w_index == n_words) {
+                w_index = 0;
+            }
+	}
+    }
+
+    void ConcurrentPool::deallocate(PoolRef ref) {
 	const auto w_index = ref.index / BITS;
 	const auto b_index = ref.index % BITS;
-	used_[w_index] &= ~(Word(1) << b_index);
-	length_--;
+	used_[w_index].fetch_and(~(Word(1) << b_index), MemoryOrder::RELEASE);
+	length_.fetch_sub(1, MemoryOrder::RELAXED);
     }
 
 } // namespace ctl
@@ -1,5 +1,6 @@
 #include "ctl/slab.hpp"
 #include "ctl/stream.hpp"
+#include "ctl/system.hpp"
 
 namespace ctl {
 
@@ -11,11 +12,22 @@ namespace ctl {
 	Uint64 caches;
     };
     // Following the header:
-    // 	Uint32 used[SlabHeader::capacity / 32]
+    // 	Uint32 used[n_words]
     // 	Pool   pools[]
     //
     // Only pools that are valid are stored. Active pools are indicated by the used
     // bitset. That is ((used[i/32] & (1 << (i%32)) != 0 indicates if pool i exists.
+    //
+    // Version 1 sized the bitset by the pool capacity (capacity / 32 words), which
+    // is too small once there are more pools than that. Version 2 sizes it by the
+    // number of pools, rounded to an even word count so the pools that follow stay
+    // 8 byte aligned for in place loads.
+    static constexpr Ulen used_words(const SlabHeader& header) {
+	if (header.version == 1) {
+            return Ulen(header.capacity / 32);
+	}
+	return Ulen((header.caches + 63) / 64 * 2);
+    }
     Maybe<Slab> Slab::load(Allocator& allocator, Stream& stream) {
 	SlabHeader header;
 	if (stream.read(Slice{&header, 1}.cast<Uint8>()) != sizeof(header)) {
@@ -24,11 +36,14 @@ namespace ctl {
 	if (Slice<const Uint8>{header.magic} != Slice{"slab"}.cast<const Uint8>()) {
             return {};
 	}
-	if (header.version != 1) {
+	if (header.version != 1 && header.version != 2) {
             return {};
 	}
+	if (header.version == 1 && header.caches > header.capacity) {
+            return {}; // Written past its bitset.
+	}
 	ScratchAllocator<1024> scratch{allocator};
-	auto n_words = static_cast<Ulen>(header.capacity / 32);
+	auto n_words = used_words(header);
 	auto used = scratch.allocate<Uint32>(n_words, true);
 	if (!used) {
             return {};
@@ -52,30 +67,38 @@ namespace ctl {
                 }
             }
 	}
-	return Slab {
+	Slab slab {
             move(caches),
             Ulen(header.size),
             Ulen(header.capacity)
 	};
+	if (!slab.relink()) {
+            return {};
+	}
+	return slab;
     }
 
-    Bool Slab::save(Stream& stream) const {
+    Bool Slab::save(Stream& stream, Pool::Format format) const {
+	// Version 1 when its bitset holds every pool, so older readers can load
+	// snapshots saved with the default DENSE pools.
+	const auto version = caches_.length() <= capacity_ ? 1_u32 : 2_u32;
 	SlabHeader header = {
             .magic    = { 's', 'l', 'a', 'b' },
-            .version  = 1,
+            .version  = version,
             .size     = Uint64(size_),
             .capacity = Uint64(capacity_),
             .caches   = Uint64(caches_.length()),
 	};
 	ScratchAllocator<1024> scratch{caches_.allocator()};
-	auto n_words = capacity_ / 32;
+	auto n_words = used_words(header);
 	auto used = scratch.allocate<Uint32>(n_words, true);
 	if (!used) {
             return false;
 	}
 	Ulen i = 0;
 	for (const auto& cache : caches_) {
-            if (cache) {
+            // Retained empty pools hold nothing worth saving.
+            if (cache && !cache->is_empty()) {
                 const auto w_index = Uint32(i / 32);
                 const auto b_index = Uint32(i % 32);
                 used[w_index] |= 1_u32 << b_index;
@@ -89,53 +112,528 @@ namespace ctl {
         if (stream.write(u_slice) != u_slice.length()) return false;
 
 	for (const auto& cache : caches_) {
-            if (cache && !cache->save(stream)) {
+            if (cache && !cache->is_empty() && !cache->save(stream, format)) {
                 return false;
             }
 	}
 	return true;
     }
 
-    Maybe<SlabRef> Slab::allocate() {
-	const auto n_caches = caches_.length();
-	for (Ulen i = n_caches - 1; i < n_caches; i--) {
-            if (auto& cache = caches_[i]; cache.is_valid()) {
-                if (auto c_ref = cache->allocate()) {
-                    return SlabRef { Uint32(i * capacity_) + c_ref->index };
+    Uint32 Slab::bucket_of(const Pool& pool) const {
+	const auto length = pool.length();
+	if (length >= capacity_) {
+            return NIL;
+	}
+	return Uint32(length * BUCKETS / capacity_);
+    }
+
+    void Slab::link(Uint32 index, Uint32 bucket) {
+	auto& node = links_[index];
+	node.prev = NIL;
+	node.next = heads_[bucket];
+	node.bucket = bucket;
+	if (node.next != NIL) {
+            links_[node.next].prev = index;
+	}
+	heads_[bucket] = index;
+	if (bucket == EMPTY) {
+            empty_++;
+	} else {
+            fill_ |= 1_u32 << bucket;
+	}
+    }
+
+    void Slab::unlink(Uint32 index) {
+	auto& node = links_[index];
+	if (node.bucket == NIL) {
+            return;
+	}
+	if (node.prev != NIL) {
+            links_[node.prev].next = node.next;
+	} else {
+            heads_[node.bucket] = node.next;
+	}
+	if (node.next != NIL) {
+            links_[node.next].prev = node.prev;
+	}
+	if (node.bucket == EMPTY) {
+            empty_--;
+	} else if (heads_[node.bucket] == NIL) {
+            fill_ &= ~(1_u32 << node.bucket);
+	}
+	node = {};
+    }
+
+    void Slab::update(Uint32 index) {
+	const auto& pool = *caches_[index];
+	const auto bucket = pool.is_empty() ? EMPTY : bucket_of(pool);
+	if (links_[index].bucket == bucket) {
+            return;
+	}
+	unlink(index);
+	if (bucket != NIL) {
+            link(index, bucket);
+	}
+    }
+
+    Bool Slab::relink() {
+	if (!links_.resize(caches_.length()) || !bases_.resize(caches_.length())) {
+            return false;
+	}
+	for (Ulen i = 0; i < caches_.length(); i++) {
+            if (caches_[i].is_valid()) {
+                bases_[i] = (*caches_[i])[PoolRef { 0 }];
+                update(Uint32(i));
+            }
+	}
+	evict(retain_);
+	trim_tail();
+	return true;
+    }
+
+    void Slab::evict(Ulen keep) {
+	while (empty_ > keep) {
+            auto victim = heads_[EMPTY];
+            for (auto i = links_[victim].next; i != NIL; i = links_[i].next) {
+                if (i > victim) {
+                    victim = i;
                 }
             }
+            unlink(victim);
+            caches_[victim].reset();
+            bases_[victim] = nullptr;
+            if (region_) {
+                Heap::decommit(region_ + victim * size_ * capacity_, size_ * capacity_);
+            }
+            stats_.evicted++;
+	}
+    }
+
+    void Slab::trim_tail() {
+	while (!caches_.is_empty() && !caches_.last().is_valid()) {
+            caches_.pop_back();
+            links_.pop_back();
+            bases_.pop_back();
 	}
-	auto pool = Pool::create(caches_.allocator(), size_, capacity_);
+    }
+
+    void Slab::retain(Ulen count) {
+	retain_ = count;
+	evict(retain_);
+	trim_tail();
+    }
+
+    void Slab::trim() {
+	evict(0);
+	trim_tail();
+    }
+
+    // Makes a pool over `size * capacity` committed bytes at `data`, which are
+    // decommitted again if that fails. Every path returns `pool` so it is
+    // constructed in place in the caller.
+    static Maybe<Pool> borrow(Allocator& allocator, Ulen size, Ulen capacity, Uint8* data) {
+	auto pool = Pool::create(allocator, size, capacity, data);
 	if (!pool) {
+            Heap::decommit(data, size * capacity);
+	}
+	return pool;
+    }
+
+    Maybe<Pool> Slab::create(Ulen index) {
+	if (!region_) {
+            return Pool::create(caches_.allocator(), size_, capacity_);
+	}
+	if (index >= limit_) {
+            return {};
+	}
+	const auto chunk = size_ * capacity_;
+	const auto data = region_ + index * chunk;
+	if (!Heap::commit(data, chunk)) {
             return {};
 	}
-	// Search for an empty Pool in the caches array
-	for (auto& cache : caches_) {
-            if (!cache.is_valid()) {
-                cache = move(*pool);
-                return allocate();
+	return borrow(caches_.allocator(), size_, capacity_, data);
+    }
+
+    Bool Slab::place() {
+	const auto chunk = size_ * capacity_;
+	for (Ulen i = 0; i < caches_.length(); i++) {
+            if (!caches_[i]) {
+                continue;
             }
+            const auto data = region_ + i * chunk;
+            if (!Heap::commit(data, chunk) || !caches_[i]->relocate(data)) {
+                return false;
+            }
+            bases_[i] = data;
 	}
-	// No empty Pool in caches array, append a new Pool.
-	if (!caches_.push_back(move(*pool))) {
+	return true;
+    }
+
+    Maybe<Uint32> Slab::acquire() {
+	if (fill_ == 0 && heads_[EMPTY] != NIL) {
+            // Every pool in use is full, take a retained empty one.
+            const auto index = heads_[EMPTY];
+            unlink(index);
+            link(index, 0);
+            stats_.recycled++;
+	} else if (fill_ == 0) {
+            // Every pool is full, add one. Reuse the slot of a destroyed pool.
+            Ulen index = 0;
+            while (index < caches_.length() && caches_[index].is_valid()) {
+                index++;
+            }
+            auto pool = create(index);
+            if (!pool) {
+                return {};
+            }
+            const auto base = (*pool)[PoolRef { 0 }];
+            if (index == caches_.length()) {
+                if (!links_.push_back(Link{})) {
+                    return {};
+                }
+                if (!bases_.push_back(base)) {
+                    links_.pop_back();
+                    return {};
+                }
+                if (!caches_.push_back(move(*pool))) {
+                    links_.pop_back();
+                    bases_.pop_back();
+                    return {};
+                }
+            } else {
+                caches_[index] = move(*pool);
+                bases_[index] = base;
+            }
+            link(Uint32(index), 0);
+            stats_.created++;
+	}
+	// Highest set bit is the fullest list with room.
+	auto bucket = BUCKETS - 1;
+	while ((fill_ & (1_u32 << bucket)) == 0) {
+            bucket--;
+	}
+	return Uint32 { heads_[bucket] };
+    }
+
+    void Slab::released(Uint32 index) {
+	// An empty pool moves to the EMPTY list, the policy decides what stays.
+	update(index);
+	if (empty_ > retain_ && !walking_) {
+            evict(retain_);
+            trim_tail();
+	}
+    }
+
+    Maybe<SlabRef> Slab::allocate() {
+	const auto index = acquire();
+	if (!index) {
             return {};
 	}
-	return allocate();
+	const auto c_ref = caches_[*index]->allocate();
+	update(*index);
+	return SlabRef { Uint32(*index * capacity_) + c_ref->index };
     }
 
     void Slab::deallocate(SlabRef slab_ref) {
         const auto cache_idx = Uint32(slab_ref.index / capacity_);
         const auto cache_ref = Uint32(slab_ref.index % capacity_);
-    
+
         caches_[cache_idx]->deallocate(PoolRef { cache_ref });
+        released(cache_idx);
+    }
 
-        if (caches_[cache_idx]->is_empty()) {
-            caches_[cache_idx].reset(); 
-        }
+    Ulen Slab::allocate_n(Slice<SlabRef> refs) {
+	Ulen n = 0;
+	while (n < refs.length()) {
+            const auto index = acquire();
+            if (!index) {
+                break;
+            }
+            // SlabRef and PoolRef are both a plain index, fill in the pool
+            // local ones and rebase them.
+            auto rest = refs.slice(n);
+            const auto count = caches_[*index]->allocate_n(rest.cast<PoolRef>());
+            for (Ulen i = 0; i < count; i++) {
+                refs[n + i].index += Uint32(*index * capacity_);
+            }
+            n += count;
+            update(*index);
+	}
+	return n;
+    }
 
-        while (!caches_.is_empty() && !caches_.last().is_valid()) {
-            caches_.pop_back();
-        }
+    void Slab::deallocate_n(Slice<const SlabRef> refs) {
+	// Hand runs of refs that share a pool to Pool::deallocate_n in batches.
+	static constexpr const Ulen BATCH = 256;
+	PoolRef batch[BATCH];
+	Ulen i = 0;
+	while (i < refs.length()) {
+            const auto cache_idx = Uint32(refs[i].index / capacity_);
+            Ulen n = 0;
+            for (; i < refs.length() && n < BATCH && refs[i].index / capacity_ == cache_idx; i++) {
+                batch[n++] = PoolRef { Uint32(refs[i].index % capacity_) };
+            }
+            caches_[cache_idx]->deallocate_n(Slice<const PoolRef>{batch, n});
+            released(cache_idx);
+	}
+    }
+
+    Ulen Slab::compact(Slice<SlabMove> moves) {
+	Ulen n = 0;
+	while (n < moves.length() && fill_ != 0) {
+            // Empty the emptiest partial pool into the fullest other one. The
+            // destination only gets fuller, so it never becomes a source later
+            // and no object moves twice. Each round empties the source or fills
+            // the destination, which ends with at most one partial pool left.
+            auto src = NIL;
+            for (auto i = heads_[count_trailing_zeros(fill_)]; i != NIL; i = links_[i].next) {
+                if (src == NIL || caches_[i]->length() < caches_[src]->length()) {
+                    src = i;
+                }
+            }
+            auto dst = NIL;
+            for (auto bucket = BUCKETS - 1; dst == NIL && bucket != NIL; bucket--) {
+                for (auto i = heads_[bucket]; i != NIL; i = links_[i].next) {
+                    if (i != src && (dst == NIL || caches_[i]->length() > caches_[dst]->length())) {
+                        dst = i;
+                    }
+                }
+            }
+            if (dst == NIL) {
+                break;
+            }
+            auto& from = *caches_[src];
+            auto& to = *caches_[dst];
+            Pool::Cursor cursor{from.used_, capacity_ / Pool::BITS};
+            while (n < moves.length() && !from.is_empty() && to.length() < capacity_) {
+                const auto old_ref = PoolRef { cursor.next() };
+                const auto new_ref = to.allocate();
+                Allocator::memcopy(Address(to[*new_ref]), Address(from[old_ref]), size_);
+                from.deallocate(old_ref);
+                moves[n++] = SlabMove {
+                    SlabRef { Uint32(src * capacity_) + old_ref.index },
+                    SlabRef { Uint32(dst * capacity_) + new_ref->index },
+                };
+            }
+            update(dst);
+            released(src);
+	}
+	return n;
+    }
+
+    Ulen VirtualSlab::round(Ulen size, Ulen capacity) {
+	// The page size is a power of two, so size * n fills whole pages once n
+	// is a multiple of the page size over the largest power of two in size.
+	const auto page = Heap::page_size();
+	const auto align = size & (~size + 1);
+	auto step = align >= page ? 1_ulen : page / align;
+	if (step < 64) {
+            step = 64;
+	}
+	return (capacity + step - 1) / step * step;
+    }
+
+    Ulen VirtualSlab::pools(Ulen capacity, Ulen max_objects) {
+	// Every slot of the last pool must still have a 32-bit SlabRef.
+	const auto limit = (max_objects + capacity - 1) / capacity;
+	const auto most = (Uint64(~0_u32) + 1) / capacity;
+	return Uint64(limit) > most ? Ulen(most) : limit;
+    }
+
+    Maybe<VirtualSlab> VirtualSlab::create(Allocator& allocator, Ulen size, Ulen capacity, Ulen max_objects, Ulen retain) {
+	if (size == 0) {
+            return {};
+	}
+	capacity = round(size, capacity);
+	const auto limit = pools(capacity, max_objects);
+	if (limit == 0) {
+            return {};
+	}
+	const auto base = static_cast<Uint8*>(Heap::reserve(limit * size * capacity));
+	if (!base) {
+            return {};
+	}
+	return VirtualSlab { Slab { allocator, size, capacity, retain }, base, limit };
+    }
+
+    Maybe<VirtualSlab> VirtualSlab::load(Allocator& allocator, Stream& stream, Ulen max_objects) {
+	auto slab = Slab::load(allocator, stream);
+	if (!slab) {
+            return {};
+	}
+	const auto size = slab->size();
+	const auto capacity = slab->capacity();
+	if (round(size, capacity) != capacity) {
+            return {};
+	}
+	const auto chunk = size * capacity;
+	const auto limit = pools(capacity, max_objects);
+	if (limit == 0 || slab->caches_.length() > limit) {
+            return {};
+	}
+	const auto base = static_cast<Uint8*>(Heap::reserve(limit * chunk));
+	if (!base) {
+            return {};
+	}
+	// Takes ownership of the reservation before anything can fail.
+	VirtualSlab result { move(*slab), base, limit };
+	if (!result.slab_.place()) {
+            return {};
+	}
+	return result;
+    }
+
+    VirtualSlab::VirtualSlab(Slab&& slab, Uint8* base, Ulen limit)
+	: base_{base}
+	, size_{slab.size()}
+	, slab_{move(slab)}
+    {
+	slab_.region_ = base;
+	slab_.limit_ = limit;
+    }
+
+    VirtualSlab::VirtualSlab(VirtualSlab&& other)
+	: base_{exchange(other.base_, nullptr)}
+	, size_{other.size_}
+	, slab_{move(other.slab_)}
+    {
+	other.slab_.region_ = nullptr;
+	other.slab_.limit_ = 0;
+    }
+
+    VirtualSlab::~VirtualSlab() {
+	if (base_) {
+            // The pools only borrow their memory, drop them before the range goes.
+            const auto length = reserved();
+            slab_.caches_.clear();
+            Heap::release(base_, length);
+	}
+    }
+
+    // Threads are numbered on their first ShardedSlab call, the number is what
+    // a shard records as its owner.
+    static constinit Atomic<Uint32> g_next_thread;
+    static thread_local constinit Uint32 t_thread = ~0_u32;
+
+    static Uint32 thread_ordinal() {
+	if (t_thread == ~0_u32) {
+            t_thread = g_next_thread.fetch_add(1, MemoryOrder::RELAXED);
+	}
+	return t_thread;
+    }
+
+    // Remote frees are linked through the first Uint32 of an object, so objects
+    // are a whole number of Uint32s: room for the link and aligned for it.
+    ShardedSlab::ShardedSlab(Allocator& allocator, Ulen size, Ulen capacity, Ulen max_objects)
+	: allocator_{allocator}
+	, size_{size < sizeof(Uint32) ? sizeof(Uint32) : (size + sizeof(Uint32) - 1) / sizeof(Uint32) * sizeof(Uint32)}
+	, capacity_{VirtualSlab::round(size_, capacity)}
+    {
+	// Whole pools only, so no local index reaches the shard bits.
+	const auto most = MAX_OBJECTS / capacity_ * capacity_;
+	max_objects_ = max_objects < most ? max_objects : most;
+	for (auto& shard : shards_) {
+            shard.remote.store(0, MemoryOrder::RELAXED);
+            shard.owner.store(NONE, MemoryOrder::RELAXED);
+	}
+    }
+
+    ShardedSlab::Shard* ShardedSlab::shard() {
+	const auto self = thread_ordinal();
+	const auto home = self % SHARDS;
+	if (shards_[home].owner.load(MemoryOrder::RELAXED) == self) {
+            return &shards_[home];
+	}
+	for (Uint32 i = 0; i < SHARDS; i++) {
+            if (shards_[i].owner.load(MemoryOrder::RELAXED) == self) {
+                return &shards_[i];
+            }
+	}
+	// Claim a free shard, starting at home so threads spread out. Acquire
+	// pairs with the release in release(), the previous owner's changes to
+	// the slab are visible once the claim succeeds.
+	for (Uint32 i = 0; i < SHARDS; i++) {
+            auto& shard = shards_[(home + i) % SHARDS];
+            auto expected = NONE;
+            if (!shard.owner.compare_exchange(expected, self, MemoryOrder::ACQUIRE)) {
+                continue;
+            }
+            if (!shard.slab) {
+                shard.slab = VirtualSlab::create(allocator_, size_, capacity_, max_objects_);
+                if (!shard.slab) {
+                    shard.owner.store(NONE, MemoryOrder::RELEASE);
+                    return nullptr;
+                }
+                bases_[(home + i) % SHARDS] = shard.slab->base_;
+            }
+            return &shard;
+	}
+	return nullptr;
+    }
+
+    void ShardedSlab::drain(Shard& shard) {
+	static constexpr const Ulen BATCH = 256;
+	SlabRef batch[BATCH];
+	Ulen n = 0;
+	// Acquire pairs with the release of every push, the links written into
+	// the objects are visible.
+	auto head = shard.remote.exchange(0, MemoryOrder::ACQUIRE);
+	while (head != 0) {
+            const auto ref = SlabRef { head - 1 };
+            // Read the link before the slot is freed, its pool may go with it.
+            head = *reinterpret_cast<const Uint32*>((*shard.slab)[ref]);
+            batch[n++] = ref;
+            if (n == BATCH) {
+                shard.slab->deallocate_n(Slice<const SlabRef>{batch, n});
+                n = 0;
+            }
+	}
+	if (n != 0) {
+            shard.slab->deallocate_n(Slice<const SlabRef>{batch, n});
+	}
+    }
+
+    Maybe<SlabRef> ShardedSlab::allocate() {
+	const auto shard = this->shard();
+	if (!shard) {
+            return {};
+	}
+	if (shard->remote.load(MemoryOrder::RELAXED) != 0) {
+            drain(*shard);
+	}
+	const auto ref = shard->slab->allocate();
+	if (!ref) {
+            return {};
+	}
+	const auto id = Uint32(shard - shards_);
+	return SlabRef { (id << LOCAL_BITS) | ref->index };
+    }
+
+    void ShardedSlab::deallocate(SlabRef slab_ref) {
+	auto& shard = shards_[slab_ref.index >> LOCAL_BITS];
+	const auto local = slab_ref.index & LOCAL_MASK;
+	if (shard.owner.load(MemoryOrder::RELAXED) == thread_ordinal()) {
+            shard.slab->deallocate(SlabRef { local });
+            return;
+	}
+	// Push onto the remote free list, linked through the object itself. The
+	// object is still allocated, so its memory stays committed until the
+	// owner drains it.
+	auto& next = *reinterpret_cast<Uint32*>((*this)[slab_ref]);
+	auto head = shard.remote.load(MemoryOrder::RELAXED);
+	do {
+            next = head;
+	} while (!shard.remote.compare_exchange(head, local + 1, MemoryOrder::RELEASE));
+    }
+
+    void ShardedSlab::release() {
+	const auto self = thread_ordinal();
+	for (auto& shard : shards_) {
+            if (shard.owner.load(MemoryOrder::RELAXED) == self) {
+                drain(shard);
+                shard.owner.store(NONE, MemoryOrder::RELEASE);
+            }
+	}
     }
 
 } // namespace ctl
@@ -30,4 +30,47 @@ namespace ctl {
 	return offset_;
     }
 
+    Maybe<MappedStream> MappedStream::open(StringView name) {
+	auto file = File::open(name, File::Access::RD);
+	if (!file) {
+            return {};
+	}
+	const auto data = file->map_private();
+	file->close();
+	if (data.is_empty()) {
+            return {};
+	}
+	return MappedStream { data };
+    }
+
+    void MappedStream::close() {
+	File::unmap(exchange(data_, Slice<Uint8>{}));
+	offset_ = 0;
+    }
+
+    Ulen MappedStream::write(Slice<const Uint8>) {
+	return 0; // Read-only.
+    }
+
+    Ulen MappedStream::read(Slice<Uint8> data) {
+	const auto left = data_.length() - offset_;
+	const auto nb = data.length() < left ? data.length() : left;
+	Allocator::memcopy(Address(data.data()), Address(data_.data() + offset_), nb);
+	offset_ += nb;
+	return nb;
+    }
+
+    Uint64 MappedStream::tell() const {
+	return offset_;
+    }
+
+    Uint8* MappedStream::map(Ulen len) {
+	if (len > data_.length() - offset_) {
+            return nullptr;
+	}
+	const auto data = data_.data() + offset_;
+	offset_ += len;
+	return data;
+    }
+
 } // namespace ctl
@@ -11,6 +11,7 @@
 #include <stdlib.h> // exit needed from libc since it calls destructors
 
 #include "ctl/system.hpp"
+#include "ctl/atomic.hpp"
 
 namespace ctl {
 
@@ -73,6 +74,19 @@ namespace ctl {
 	return 0;
     }
 
+    void* Filesystem::map_file(Filesystem::File* file, Uint64 len) {
+	auto fd = reinterpret_cast<Address>(file);
+	auto addr = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	if (addr == MAP_FAILED) {
+            return nullptr;
+	}
+	return addr;
+    }
+
+    void Filesystem::unmap_file(void* addr, Uint64 len) {
+	munmap(addr, len);
+    }
+
     Filesystem::Directory* Filesystem::open_dir(StringView name) {
         auto sys_allocator = SystemAllocator();
 	ScratchAllocator<1024> scratch{sys_allocator};
@@ -145,6 +159,185 @@ namespace ctl {
 #endif
     }
 
+    void* Heap::resize(void* addr, Ulen old_len, Ulen new_len, Bool zero) {
+#if defined(CTL_CFG_USE_MALLOC)
+	if (new_len <= old_len) {
+            return addr; // realloc may move on shrink, keep the block as is.
+	}
+	auto ptr = realloc(addr, new_len);
+	if (ptr && zero) {
+            memset(static_cast<Uint8*>(ptr) + old_len, 0, new_len - old_len);
+	}
+	return ptr;
+#else
+	const auto page = page_size();
+	const auto old_size = (old_len + page - 1) & ~(page - 1);
+	const auto new_size = (new_len + page - 1) & ~(page - 1);
+	const auto bytes = static_cast<Uint8*>(addr);
+	if (new_size <= old_size) {
+            if (new_size < old_size) {
+                // Give the tail pages back.
+    #if defined(CTL_HOST_PLATFORM_LINUX)
+                if (mremap(addr, old_size, new_size, 0) == MAP_FAILED) {
+                    return nullptr;
+                }
+    #else
+                munmap(bytes + new_size, old_size - new_size);
+    #endif
+            } else if (zero && new_len > old_len) {
+                memset(bytes + old_len, 0, new_len - old_len);
+            }
+            return addr;
+	}
+    #if defined(CTL_HOST_PLATFORM_LINUX)
+	// Extends in place when the following range is free, otherwise moves the
+	// pages to a new range. Either way only page tables are touched.
+	auto ptr = mremap(addr, old_size, new_size, MREMAP_MAYMOVE);
+	if (ptr == MAP_FAILED) {
+            return nullptr;
+	}
+	if (zero) {
+            // Fresh pages are zero, only the tail of the old last page may be stale.
+            memset(static_cast<Uint8*>(ptr) + old_len, 0, old_size - old_len);
+	}
+	return ptr;
+    #else
+	return nullptr;
+    #endif
+#endif
+    }
+
+#if !defined(CTL_CFG_USE_MALLOC)
+    static constexpr Ulen round_huge(Ulen length) {
+	return (length + Heap::HUGE_PAGE_SIZE - 1) & ~(Heap::HUGE_PAGE_SIZE - 1);
+    }
+
+    #if defined(MAP_HUGETLB)
+    // Set once an explicit huge page mapping failed, usually because no pool of
+    // huge pages was reserved (vm.nr_hugepages), to skip the syscall after.
+    static constinit Atomic<Uint32> g_no_hugetlb;
+    #endif
+#endif
+
+    void* Heap::allocate_huge(Ulen length, [[maybe_unused]] Bool zero) {
+#if defined(CTL_CFG_USE_MALLOC)
+	return allocate(length, zero);
+#else
+	const auto size = round_huge(length);
+    #if defined(MAP_HUGETLB)
+	if (!g_no_hugetlb.load(MemoryOrder::RELAXED)) {
+            auto addr = mmap(nullptr,
+                             size,
+                             PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,
+                             -1,
+                             0);
+            if (addr != MAP_FAILED) {
+                return addr;
+            }
+            g_no_hugetlb.store(1, MemoryOrder::RELAXED);
+	}
+    #endif
+	// Map one huge page more than needed so an aligned range fits, then trim
+	// the rest. The kernel can only back aligned ranges with huge pages.
+	auto base = mmap(nullptr,
+	                 size + HUGE_PAGE_SIZE,
+	                 PROT_READ | PROT_WRITE,
+	                 MAP_PRIVATE | MAP_ANONYMOUS,
+	                 -1,
+	                 0);
+	if (base == MAP_FAILED) {
+            return nullptr;
+	}
+	const auto beg = reinterpret_cast<Address>(base);
+	const auto addr = (beg + HUGE_PAGE_SIZE - 1) & ~Address(HUGE_PAGE_SIZE - 1);
+	if (addr != beg) {
+            munmap(base, addr - beg);
+	}
+	const auto tail = beg + size + HUGE_PAGE_SIZE - (addr + size);
+	if (tail) {
+            munmap(reinterpret_cast<void*>(addr + size), tail);
+	}
+	const auto ptr = reinterpret_cast<void*>(addr);
+    #if defined(MADV_HUGEPAGE)
+	// Fails harmlessly when transparent huge pages are disabled.
+	madvise(ptr, size, MADV_HUGEPAGE);
+    #endif
+	return ptr;
+#endif
+    }
+
+    void Heap::deallocate_huge(void* addr, Ulen length) {
+#if defined(CTL_CFG_USE_MALLOC)
+	deallocate(addr, length);
+#else
+	munmap(addr, round_huge(length));
+#endif
+    }
+
+    void* Heap::resize_huge(void* addr, Ulen old_len, Ulen new_len, Bool zero) {
+#if defined(CTL_CFG_USE_MALLOC)
+	return resize(addr, old_len, new_len, zero);
+#else
+	const auto old_size = round_huge(old_len);
+	const auto new_size = round_huge(new_len);
+	const auto bytes = static_cast<Uint8*>(addr);
+	if (new_size < old_size) {
+            munmap(bytes + new_size, old_size - new_size);
+	} else if (new_size > old_size) {
+            // Remapping would lose the alignment, let the caller move the block.
+            return nullptr;
+	} else if (zero && new_len > old_len) {
+            memset(bytes + old_len, 0, new_len - old_len);
+	}
+	return addr;
+#endif
+    }
+
+    // A function local static would go through the guard in cpprt.cpp, which
+    // is not thread safe. Threads racing on the first call store the same value.
+    static constinit Atomic<Ulen> g_page_size;
+
+    Ulen Heap::page_size() {
+	auto page = g_page_size.load(MemoryOrder::RELAXED);
+	if (page == 0) {
+            page = Ulen(sysconf(_SC_PAGESIZE));
+            g_page_size.store(page, MemoryOrder::RELAXED);
+	}
+	return page;
+    }
+
+    void* Heap::reserve(Ulen length) {
+	auto addr = mmap(nullptr,
+	                 length,
+	                 PROT_NONE,
+	                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+	                 -1,
+	                 0);
+	if (addr == MAP_FAILED) {
+            return nullptr;
+	}
+	return addr;
+    }
+
+    Bool Heap::commit(void* addr, Ulen length) {
+	return mprotect(addr, length, PROT_READ | PROT_WRITE) == 0;
+    }
+
+    void Heap::decommit(void* addr, Ulen length) {
+	// Mapping fresh inaccessible pages over the range drops the old ones.
+	mmap(addr,
+	     length,
+	     PROT_NONE,
+	     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED,
+	     -1,
+	     0);
+    }
+
+    void Heap::release(void* addr, Ulen length) {
+	munmap(addr, length);
+    }
+
     void Console::print(StringView data) {
 	write(STDOUT_FILENO, data.data(), data.length());
     }
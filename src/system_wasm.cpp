@@ -100,6 +100,66 @@ namespace ctl {
         // No-op. See comments
     }
 
+    void* Heap::resize(void* addr, Ulen old_len, Ulen new_len, Bool zero) {
+        if (new_len <= old_len) {
+            return addr;
+        }
+        // Only the most recent block can be extended, by pushing the break.
+        const auto old_end = static_cast<unsigned char*>(addr) + ((old_len + 15) & ~Ulen(15));
+        if (old_end != g_brk) {
+            return nullptr;
+        }
+        const Ulen delta = ((new_len + 15) & ~Ulen(15)) - ((old_len + 15) & ~Ulen(15));
+        if (g_brk + delta > g_brk_end) {
+            const Ulen needed = (g_brk + delta) - g_brk_end;
+            const Ulen pages  = (needed + WASM_PAGE_SIZE - 1) / WASM_PAGE_SIZE;
+            const auto prev   = __builtin_wasm_memory_grow(0, pages);
+            if (prev == static_cast<decltype(prev)>(-1)) {
+                return nullptr;
+            }
+            g_brk_end += pages * WASM_PAGE_SIZE;
+        }
+        g_brk += delta;
+        if (zero) {
+            auto p = static_cast<unsigned char*>(addr);
+            for (Ulen i = old_len; i < new_len; i++) p[i] = 0;
+        }
+        return addr;
+    }
+
+    // Linear memory has no pages of different sizes.
+    void* Heap::allocate_huge(Ulen length, Bool zero) {
+        return allocate(length, zero);
+    }
+
+    void Heap::deallocate_huge(void* addr, Ulen length) {
+        deallocate(addr, length);
+    }
+
+    void* Heap::resize_huge(void* addr, Ulen old_len, Ulen new_len, Bool zero) {
+        return resize(addr, old_len, new_len, zero);
+    }
+
+    // Linear memory has no address space to reserve, so virtual memory
+    // reservations are not supported.
+    Ulen Heap::page_size() {
+        return WASM_PAGE_SIZE;
+    }
+
+    void* Heap::reserve(Ulen) {
+        return nullptr;
+    }
+
+    Bool Heap::commit(void*, Ulen) {
+        return false;
+    }
+
+    void Heap::decommit(void*, Ulen) {
+    }
+
+    void Heap::release(void*, Ulen) {
+    }
+
     // ----------------------------------------------------------------------
     // Console
     // ----------------------------------------------------------------------
@@ -163,6 +223,14 @@ namespace ctl {
         return host_fs_size(fd);
     }
 
+    // No file mappings on the host, callers fall back to reading.
+    void* Filesystem::map_file(Filesystem::File*, Uint64) {
+        return nullptr;
+    }
+
+    void Filesystem::unmap_file(void*, Uint64) {
+    }
+
     Filesystem::Directory* Filesystem::open_dir(StringView name) {
         const int dir = host_fs_opendir(name.data(),
                                         static_cast<unsigned>(name.length()));
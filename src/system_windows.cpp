@@ -8,6 +8,7 @@
 
 #if defined(CTL_CFG_USE_MALLOC)
 #include <stdlib.h>
+#include <string.h>
 #endif
 
 namespace ctl {
@@ -200,6 +201,26 @@ namespace ctl {
 	return 0;
     }
 
+    void* Filesystem::map_file(Filesystem::File* file, Uint64 len) {
+	auto mapping = CreateFileMappingW(reinterpret_cast<HANDLE>(file),
+	                                  nullptr,
+	                                  PAGE_WRITECOPY,
+	                                  0,
+	                                  0,
+	                                  nullptr);
+	if (!mapping) {
+            return nullptr;
+	}
+	auto addr = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, static_cast<SIZE_T>(len));
+	// The view keeps the mapping object alive.
+	CloseHandle(mapping);
+	return addr;
+    }
+
+    void Filesystem::unmap_file(void* addr, Uint64) {
+	UnmapViewOfFile(addr);
+    }
+
     struct FindData {
 	FindData(Allocator& allocator)
             : allocator{allocator}
@@ -281,10 +302,84 @@ namespace ctl {
 #if defined(CTL_CFG_USE_MALLOC)
 	free(address);
 #else
-	VirtualFree(address, length, MEM_RELEASE);
+	// MEM_RELEASE frees the whole reservation and requires a size of zero.
+	VirtualFree(address, 0, MEM_RELEASE);
+#endif
+    }
+
+    void* Heap::resize(void* address, Ulen old_len, Ulen new_len, Bool zero) {
+#if defined(CTL_CFG_USE_MALLOC)
+	if (new_len <= old_len) {
+            return address;
+	}
+	auto ptr = realloc(address, new_len);
+	if (ptr && zero) {
+            memset(static_cast<Uint8*>(ptr) + old_len, 0, new_len - old_len);
+	}
+	return ptr;
+#else
+	(void)zero;
+	if (new_len > old_len) {
+            // A reservation cannot be extended, the caller has to copy.
+            return nullptr;
+	}
+	// Decommit whole tail pages, the range stays reserved until deallocate.
+	const auto page = page_size();
+	const auto keep = (new_len + page - 1) & ~(page - 1);
+	const auto size = (old_len + page - 1) & ~(page - 1);
+	if (keep < size) {
+            VirtualFree(static_cast<Uint8*>(address) + keep, size - keep, MEM_DECOMMIT);
+	}
+	return address;
 #endif
     }
 
+    void* Heap::allocate_huge(Ulen length, Bool zero) {
+#if !defined(CTL_CFG_USE_MALLOC)
+	// Large pages need the SeLockMemoryPrivilege, without it this fails and
+	// the block gets regular pages. There is no transparent variant.
+	if (const auto large = Ulen(GetLargePageMinimum())) {
+            const auto size = (length + large - 1) & ~(large - 1);
+            const auto flags = MEM_COMMIT | MEM_RESERVE | MEM_LARGE_PAGES;
+            if (auto addr = VirtualAlloc(nullptr, size, flags, PAGE_READWRITE)) {
+                return addr;
+            }
+	}
+#endif
+	return allocate(length, zero);
+    }
+
+    void Heap::deallocate_huge(void* address, Ulen length) {
+	deallocate(address, length);
+    }
+
+    void* Heap::resize_huge(void* address, Ulen old_len, Ulen new_len, Bool zero) {
+	// Decommitting the tail fails harmlessly on large pages.
+	return resize(address, old_len, new_len, zero);
+    }
+
+    Ulen Heap::page_size() {
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return Ulen(info.dwPageSize);
+    }
+
+    void* Heap::reserve(Ulen length) {
+	return VirtualAlloc(nullptr, length, MEM_RESERVE, PAGE_NOACCESS);
+    }
+
+    Bool Heap::commit(void* address, Ulen length) {
+	return VirtualAlloc(address, length, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+    }
+
+    void Heap::decommit(void* address, Ulen length) {
+	VirtualFree(address, length, MEM_DECOMMIT);
+    }
+
+    void Heap::release(void* address, Ulen) {
+	VirtualFree(address, 0, MEM_RELEASE);
+    }
+
     void Console::print(StringView data) {
 	auto handle = GetStdHandle(STD_OUTPUT_HANDLE);
         DWORD bytes_to_write = static_cast<DWORD>(data.length());
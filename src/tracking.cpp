@@ -0,0 +1,164 @@
+#include "ctl/tracking.hpp"
+#include "ctl/system.hpp"
+
+namespace ctl {
+
+    // Threads are handed shards round-robin on their first tracked call.
+    static constinit Atomic<Uint32> g_next_shard;
+    static thread_local constinit Uint32 t_shard = ~0_u32;
+
+    TrackingAllocator::Shard& TrackingAllocator::shard() {
+	if (t_shard == ~0_u32) {
+            t_shard = g_next_shard.fetch_add(1, MemoryOrder::RELAXED);
+	}
+	return shards_[t_shard % SHARDS];
+    }
+
+    void TrackingAllocator::account(Shard& shard, Sint64 delta) {
+	const auto pending = shard.pending.fetch_add(delta, MemoryOrder::RELAXED) + delta;
+	if (pending < FLUSH && pending > -FLUSH) {
+            if (delta > 0) {
+                // Growth below FLUSH only raises the shard's own high-water
+                // mark, the shared total is read but not written.
+                const auto live = live_.load(MemoryOrder::RELAXED) + pending;
+                auto peak = shard.peak.load(MemoryOrder::RELAXED);
+                while (live > peak && !shard.peak.compare_exchange(peak, live, MemoryOrder::RELAXED)) {
+                    // peak reloaded by compare_exchange
+                }
+            }
+            return;
+	}
+	const auto flushed = shard.pending.exchange(0, MemoryOrder::RELAXED);
+	const auto live = live_.fetch_add(flushed, MemoryOrder::RELAXED) + flushed;
+	auto peak = peak_.load(MemoryOrder::RELAXED);
+	while (live > peak && !peak_.compare_exchange(peak, live, MemoryOrder::RELAXED)) {
+            // peak reloaded by compare_exchange
+	}
+    }
+
+    AllocatorStats TrackingAllocator::stats() const {
+	AllocatorStats stats;
+	Sint64 pending = 0;
+	for (const auto& shard : shards_) {
+            stats.allocs         += shard.allocs.load(MemoryOrder::RELAXED);
+            stats.frees          += shard.frees.load(MemoryOrder::RELAXED);
+            stats.grows_in_place += shard.grows_in_place.load(MemoryOrder::RELAXED);
+            stats.grows_moved    += shard.grows_moved.load(MemoryOrder::RELAXED);
+            stats.shrinks        += shard.shrinks.load(MemoryOrder::RELAXED);
+            stats.failures       += shard.failures.load(MemoryOrder::RELAXED);
+            pending              += shard.pending.load(MemoryOrder::RELAXED);
+            if (const auto peak = shard.peak.load(MemoryOrder::RELAXED); peak > stats.bytes_peak) {
+                stats.bytes_peak = peak;
+            }
+            for (Ulen i = 0; i < AllocatorStats::BUCKETS; i++) {
+                stats.histogram[i] += shard.histogram[i].load(MemoryOrder::RELAXED);
+            }
+	}
+	stats.bytes_live = live_.load(MemoryOrder::RELAXED) + pending;
+	if (const auto peak = peak_.load(MemoryOrder::RELAXED); peak > stats.bytes_peak) {
+            stats.bytes_peak = peak;
+	}
+	if (stats.bytes_live > stats.bytes_peak) {
+            stats.bytes_peak = stats.bytes_live;
+	}
+	return stats;
+    }
+
+    void AllocatorStats::dump(StringView name, StringBuilder& builder) const {
+	builder.put('[');
+	builder.put(name);
+	builder.put(']');
+	builder.format(" allocs %llu, frees %llu, live %lld bytes, peak %lld bytes\n",
+	               allocs, frees, bytes_live, bytes_peak);
+	builder.format("  grows %llu in place, %llu moved; shrinks %llu; failures %llu\n",
+	               grows_in_place, grows_moved, shrinks, failures);
+	for (Ulen i = 0; i < BUCKETS; i++) {
+            if (histogram[i] == 0) {
+                continue;
+            }
+            builder.format("  <= %llu bytes: %llu\n", 1_u64 << i, histogram[i]);
+	}
+    }
+
+    void TrackingAllocator::report(StringBuilder& builder) const {
+	stats().dump(name_, builder);
+    }
+
+    void TrackingAllocator::print() const {
+	ScratchAllocator<4096> scratch{allocator_};
+	StringBuilder builder{scratch};
+	report(builder);
+	if (auto result = builder.result()) {
+            Console::print(*result);
+	}
+    }
+
+    Address TrackingAllocator::allocated(Address addr, Ulen new_len) {
+	auto& s = shard();
+	if (!addr) {
+            s.failures.fetch_add(1, MemoryOrder::RELAXED);
+            return 0;
+	}
+	s.allocs.fetch_add(1, MemoryOrder::RELAXED);
+	s.histogram[AllocatorStats::bucket(new_len)].fetch_add(1, MemoryOrder::RELAXED);
+	account(s, Sint64(new_len));
+	return addr;
+    }
+
+    void TrackingAllocator::freed(Ulen old_len) {
+	auto& s = shard();
+	s.frees.fetch_add(1, MemoryOrder::RELAXED);
+	account(s, -Sint64(old_len));
+    }
+
+    Address TrackingAllocator::grown(Address old_addr, Address new_addr, Ulen old_len, Ulen new_len) {
+	auto& s = shard();
+	if (!new_addr) {
+            s.failures.fetch_add(1, MemoryOrder::RELAXED);
+            return 0;
+	}
+	if (new_addr == old_addr) {
+            s.grows_in_place.fetch_add(1, MemoryOrder::RELAXED);
+	} else {
+            s.grows_moved.fetch_add(1, MemoryOrder::RELAXED);
+	}
+	account(s, Sint64(new_len - old_len));
+	return new_addr;
+    }
+
+    Address TrackingAllocator::alloc(Ulen new_len, Bool zero) {
+	return allocated(allocator_.alloc(new_len, zero), new_len);
+    }
+
+    void TrackingAllocator::free(Address addr, Ulen old_len) {
+	if (addr == 0) return;
+	allocator_.free(addr, old_len);
+	freed(old_len);
+    }
+
+    void TrackingAllocator::shrink(Address addr, Ulen old_len, Ulen new_len) {
+	auto& s = shard();
+	allocator_.shrink(addr, old_len, new_len);
+	s.shrinks.fetch_add(1, MemoryOrder::RELAXED);
+	account(s, -Sint64(old_len - new_len));
+    }
+
+    Address TrackingAllocator::grow(Address addr, Ulen old_len, Ulen new_len, Bool zero) {
+	return grown(addr, allocator_.grow(addr, old_len, new_len, zero), old_len, new_len);
+    }
+
+    Address TrackingAllocator::alloc_aligned(Ulen new_len, Ulen align, Bool zero) {
+	return allocated(allocator_.alloc_aligned(new_len, align, zero), new_len);
+    }
+
+    void TrackingAllocator::free_aligned(Address addr, Ulen old_len, Ulen align) {
+	if (addr == 0) return;
+	allocator_.free_aligned(addr, old_len, align);
+	freed(old_len);
+    }
+
+    Address TrackingAllocator::grow_aligned(Address addr, Ulen old_len, Ulen new_len, Ulen align, Bool zero) {
+	return grown(addr, allocator_.grow_aligned(addr, old_len, new_len, align, zero), old_len, new_len);
+    }
+
+} // namespace ctl